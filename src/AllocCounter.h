@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+
+//Counts every call to the global operator new, on any thread, so a frame can
+//check that it allocated nothing: read the count before and after. Building
+//with -DTWINI_NO_ALLOC_COUNTER leaves operator new alone and the count at 0.
+uint64_t getAllocationCount();
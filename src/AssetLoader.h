@@ -0,0 +1,49 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
+#include <string>
+#include <vector>
+
+enum AssetType
+{
+	ASSET_IMAGE,
+	ASSET_SOUND
+};
+
+struct AssetJob
+{
+	std::string path;
+	int type;
+	SDL_Surface* surface;
+	Mix_Chunk* chunk;
+	SDL_atomic_t ready;
+};
+
+//Decodes PNGs into surfaces and sounds into mixer-format PCM on worker
+//threads. Uploading the surfaces is left to the render thread. Queue every
+//asset, call start(), then poll the handles.
+class AssetLoader
+{
+public:
+	AssetLoader();
+	~AssetLoader();
+	int queueImage(const char* p_filePath);
+	int queueSound(const char* p_filePath);
+	void setSoundCacheDir(const char* p_cacheDir);
+	void start();
+	bool isReady(int p_handle);
+	bool isDone();
+	SDL_Surface* takeSurface(int p_handle);
+	Mix_Chunk* takeChunk(int p_handle);
+	void wait();
+private:
+	static int workerMain(void* p_loader);
+	void runJobs();
+	int queue(const char* p_filePath, int p_type);
+	std::string soundCacheDir;
+	std::vector<AssetJob*> jobs;
+	std::vector<SDL_Thread*> workers;
+	SDL_atomic_t nextJob;
+	SDL_atomic_t doneCount;
+};
@@ -1,62 +1,43 @@
 #pragma once
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_mixer.h>
 #include <vector>
-#include "Hole.h"
-#include "Tile.h"
 
-#include "Entity.h"
+#include "EntityStore.h"
 #include "Math.h"
+#include "Simulation.h"
+#include "CollisionWorld.h"
 
-class Ball : public Entity
+//the ball, its shadow, the aim arrow and the three parts of the power bar
+const int BALL_ENTITY_COUNT = 6;
+
+class Ball
 {
 public:
-	Ball(Vector2f p_pos, SDL_Texture* p_tex, SDL_Texture* p_pointTex, SDL_Texture* p_powerMTexFG, SDL_Texture* p_powerMTexBG, int p_index);
-    Vector2f& getVelocity()
-	{
-		return velocity;
-	}
-    Vector2f& getInitialMousePos()
-	{
-		return initialMousePos;
-	}
-    std::vector<Entity> getPoints()
-	{
-		return points;
-	}
-    std::vector<Entity> getPowerBar()
-	{
-		return powerBar;
-	}
+	Ball(int p_index, int p_sprite, int p_shadowSprite, int p_pointSprite, int p_powerMSpriteFG, int p_powerMSpriteBG, int p_powerMSpriteOverlay);
+    BallState& getState()
+    {
+        return state;
+    }
+    const BallState& getState() const
+    {
+        return state;
+    }
     int getStrokes()
     {
-        return strokes;
+        return state.strokes;
     }
     bool isWin()
     {
-        return win;
+        return state.win;
     }
-    void setWin(bool p_win);
-    void setInitialMousePos(float x, float y);
-    void setVelocity(float x, float y);
-    void setLaunchedVelocity(float x, float y);
-    void update(double deltaTime, bool mouseDown, bool mousePressed, std::vector<Tile> tiles, std::vector<Hole> holes,Mix_Chunk* chargeSfx, Mix_Chunk* swingSfx, Mix_Chunk* holeSfx);
+    void spawn(EntityStore& p_store);
+    void reset(Vector2f p_pos);
+    //jumps to p_state without interpolating from where the ball was
+    void setState(const BallState& p_state);
+    void update(const ShotInput& p_input, const CollisionWorld& p_world, const Course& p_course, std::vector<SimEvent>& p_events);
+    void interpolate(EntityStore& p_store, float p_alpha);
 private:
-    Vector2f velocity;
-    Vector2f target;
-    Vector2f launchedVelocity;
-    float velocity1D;
-    float launchedVelocity1D;
-    Vector2f initialMousePos;
-    bool canMove = true;
-    bool playedSwingFx = true;
-    int index;
-    int strokes = 0;
-    int dirX = 1;
-    int dirY = 1;
-    bool win = false;
-    float friction = 0.001;
-    std::vector<Entity> points;
-    std::vector<Entity> powerBar;
-};
\ No newline at end of file
+    BallState state;
+    BallState previousState;
+    int sprites[BALL_ENTITY_COUNT];
+    int entities[BALL_ENTITY_COUNT];
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+
+#include "Math.h"
+#include "Simulation.h"
+
+//the bottom 3px of a tile sprite is its lip, which the ball may roll over
+const float TILE_LIP = 3;
+const float COLLISION_CELL_SIZE = 32;
+
+//Flat view of a built grid. Either points into a CollisionWorld's own
+//arrays or straight into a memory-mapped level pack.
+struct CollisionGrid
+{
+	float originX;
+	float originY;
+	int cols;
+	int rows;
+	int boxCount;
+	const SimRect* boxes;
+	const int* boxCells; //first cell x, y of each box
+	const int* cellStart; //cols*rows + 1 entries
+	const int* cellTiles;
+};
+
+struct SweepHit
+{
+	float time;
+	int axis; //0 = x, 1 = y
+	int tile;
+};
+
+//Uniform grid over a level's tiles, built once per level. Queries only read
+//the grid, so one world can be shared by every ball stepping on it.
+class CollisionWorld
+{
+public:
+	CollisionWorld();
+	CollisionWorld(const CollisionWorld&) = delete;
+	CollisionWorld& operator=(const CollisionWorld&) = delete;
+	void build(const std::vector<SimRect>& p_tiles);
+	void view(const CollisionGrid& p_grid);
+	void reserve(int p_cellTileCount);
+	bool sweep(Vector2f p_pos, Vector2f p_size, Vector2f p_delta, SweepHit& p_hit) const;
+	const CollisionGrid& getGrid() const
+	{
+		return grid;
+	}
+private:
+	int cellX(float x) const;
+	int cellY(float y) const;
+	void packCells();
+	CollisionGrid grid;
+	std::vector<SimRect> boxes;
+	std::vector<int> boxCells;
+	std::vector<int> cellStart;
+	std::vector<int> cellTiles;
+	//min/max of the box behind every cellTiles entry, for the SIMD sweep
+	std::vector<float> cellMinX;
+	std::vector<float> cellMinY;
+	std::vector<float> cellMaxX;
+	std::vector<float> cellMaxY;
+};
@@ -0,0 +1,148 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <vector>
+
+#include "RenderWindow.h"
+#include "EntityStore.h"
+#include "ParticleStore.h"
+#include "Ball.h"
+#include "Level.h"
+#include "LevelPack.h"
+#include "Session.h"
+#include "RingQueue.h"
+
+enum SpriteId
+{
+	SPRITE_BALL,
+	SPRITE_HOLE,
+	SPRITE_POINT,
+	SPRITE_TILE_DARK_32,
+	SPRITE_TILE_DARK_64,
+	SPRITE_TILE_LIGHT_32,
+	SPRITE_TILE_LIGHT_64,
+	SPRITE_BALL_SHADOW,
+	SPRITE_BG,
+	SPRITE_UI_BG,
+	SPRITE_LEVELTEXT_BG,
+	SPRITE_POWERMETER_FG,
+	SPRITE_POWERMETER_BG,
+	SPRITE_POWERMETER_OVERLAY,
+	SPRITE_LOGO,
+	SPRITE_CLICK2START,
+	SPRITE_ENDSCREEN_OVERLAY,
+	SPRITE_SPLASH_BG,
+	SPRITE_COUNT
+};
+
+extern const char* spritePaths[SPRITE_COUNT];
+extern const int tileSprites[TILE_TYPE_COUNT];
+//how many effect particles can be alive at once, a full store just shows no more
+const int PARTICLE_CAPACITY = 1 << 14;
+
+//a ball drawn with the game's sprites, for Session::setCourseCount
+Ball createBall();
+//room for the biggest level's holes and tiles and every course's ball, so
+//loading a level reuses the same arrays
+void reserveEntities(const LevelPack& p_pack, int p_courseCount, EntityStore& p_entities);
+//rebuilds p_entities from the level p_session is on, the holes and tiles first,
+//then BALL_ENTITY_COUNT per course; returns how many holes and tiles there are
+int loadLevelEntities(const LevelPack& p_pack, Session& p_session, EntityStore& p_entities);
+
+//everything CourseRenderer draws, copied out of the session so it can be
+//drawn on another thread than the one stepping it
+struct FrameSnapshot
+{
+	EntityStore entities;
+	int levelEntityCount = 0;
+	//counts level loads, the static layer and views are redone when it changes
+	int levelLoads = -1;
+	int level = 0;
+	int levelCourseCount = 1;
+	std::vector<SimRect> bounds;
+	int state = 1;
+	char strokeText[32] = "";
+	char hudText[32] = "";
+	//how long drawing may block for input, 0 while anything moves
+	int idleMs = 0;
+};
+
+//like reserveEntities, for a snapshot's copy of the entities and bounds
+void reserveFrame(const LevelPack& p_pack, int p_courseCount, FrameSnapshot& p_frame);
+//fills in what p_frame shows of p_session; the caller sets levelLoads, state,
+//hudText and idleMs
+void copySession(const Session& p_session, const EntityStore& p_entities, int p_levelEntityCount, FrameSnapshot& p_frame);
+
+//Draws a frame of play: every course in a grid of viewports with its effects,
+//the HUD and the end screen. The game and tools/bench.cpp both draw through
+//this, so the bench times and checks the code that ships.
+class CourseRenderer
+{
+public:
+	CourseRenderer() = default;
+	CourseRenderer(const CourseRenderer&) = delete;
+	CourseRenderer& operator=(const CourseRenderer&) = delete;
+	//p_sprites is read when drawing, so it may be filled in later
+	void init(RenderWindow* p_window, const Sprite* p_sprites, TTF_Font* p_font24, TTF_Font* p_font32, TTF_Font* p_font48, int p_courseCount);
+	void cleanUp();
+	//the driver threw away what was in the static layer
+	void invalidate()
+	{
+		staticLayerDirty = true;
+	}
+	//a hole-out bursts, a bounce kicks up dust; this may be called from the
+	//thread stepping the session, draw() picks the effect up
+	void queueEffect(const SimEvent& p_event)
+	{
+		effectQueue.push(p_event);
+	}
+	//draws p_frame, p_seconds after the last one, ready to be presented
+	void draw(const FrameSnapshot& p_frame, float p_seconds);
+	const ViewTransform& getView(int p_course) const
+	{
+		return views[p_course];
+	}
+	bool hasEffects() const
+	{
+		return particles.size() > 0;
+	}
+	//false where render targets aren't supported, the static scene is drawn every frame then
+	bool hasStaticLayer() const
+	{
+		return staticLayer != NULL;
+	}
+	//counts changes to the level or HUD text; a frame with one lays out new text
+	//and redraws the static layer, so it isn't a steady one
+	int getStaticChanges() const
+	{
+		return staticChanges;
+	}
+private:
+	void layoutCourses(const FrameSnapshot& p_frame);
+	void renderStatic(const FrameSnapshot& p_frame, const char* p_hudText);
+	void addEffect(const SimEvent& p_event);
+	void updateParticles(const FrameSnapshot& p_frame, float p_seconds);
+
+	RenderWindow* window = NULL;
+	const Sprite* sprites = NULL;
+	TTF_Font* font24 = NULL;
+	TTF_Font* font32 = NULL;
+	TTF_Font* font48 = NULL;
+	int courseCount = 0;
+	//each course's place on screen; sounds are panned by it too
+	std::vector<ViewTransform> views;
+	int drawnLevelLoads = -1;
+
+	//the background, holes, tiles and HUD panels only change with the level or
+	//the stroke count, so they are drawn into staticLayer then and copied each frame
+	SDL_Texture* staticLayer = NULL;
+	bool staticLayerDirty = true;
+	char staticLayerText[32] = "";
+	int staticChanges = 0;
+
+	//effects are only for show, so a full queue or store just loses a few
+	RingQueue<SimEvent, 256> effectQueue;
+	ParticleStore particles;
+	//time since each course's ball last left a trail particle
+	std::vector<float> trailTimes;
+};
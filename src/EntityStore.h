@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+
+#include "Math.h"
+
+enum EntityKind
+{
+	ENTITY_TILE,
+	ENTITY_HOLE,
+	ENTITY_BALL,
+	ENTITY_BALL_SHADOW,
+	ENTITY_POINT,
+	ENTITY_POWERBAR_BG,
+	ENTITY_POWERBAR_FG,
+	ENTITY_POWERBAR_OVERLAY,
+	ENTITY_KIND_COUNT
+};
+
+const unsigned int ENTITY_HIDDEN = 1;
+
+//Everything drawn on a course, one array per component. Rebuilt by loadLevel,
+//so once the arrays have grown to the biggest level nothing here allocates.
+struct EntityStore
+{
+	void reserve(int p_count);
+	void clear();
+	int add(int p_kind, int p_sprite, Vector2f p_pos);
+	int size() const
+	{
+		return kind.size();
+	}
+
+	std::vector<float> posX;
+	std::vector<float> posY;
+	std::vector<float> velX;
+	std::vector<float> velY;
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> angle;
+	std::vector<int> sprite;
+	std::vector<int> kind;
+	std::vector<unsigned int> flags;
+};
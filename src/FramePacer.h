@@ -0,0 +1,28 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+//SDL_Delay can oversleep by about a millisecond, so the end of each wait is spun
+const double FRAME_SPIN_MS = 2;
+
+//Holds the main loop to a target frame rate. Frames are due on a fixed
+//schedule, so a slow frame is made up by shorter waits after it instead of
+//drifting, and a loop that fell more than a frame behind starts over from now.
+class FramePacer
+{
+public:
+	FramePacer();
+	//0 leaves the frame rate uncapped
+	void setTargetFps(double p_fps);
+	double getTargetFps() const
+	{
+		return targetFps;
+	}
+	void wait();
+	//blocks until an event arrives or p_timeoutMs pass, for when nothing on screen moves
+	void idle(int p_timeoutMs);
+private:
+	double targetFps;
+	Uint64 frequency;
+	Uint64 period;
+	Uint64 nextFrame;
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "Simulation.h"
+
+//Per-tick ShotInput log of a session, so it can be replayed exactly.
+//After the header comes one entry for every tick whose input differs from
+//the tick before (with mousePressed dropped, since a click only lasts one
+//tick):
+//  varint   ticks since the previous entry
+//  uint8    INPUT_* flags
+//  int16 x2 mouse position, only when INPUT_MOVED is set
+const char INPUT_LOG_MAGIC[4] = {'T', 'G', 'I', 'L'};
+const uint32_t INPUT_LOG_VERSION = 3;
+
+const uint8_t INPUT_DOWN = 1;
+const uint8_t INPUT_PRESSED = 2;
+const uint8_t INPUT_MOVED = 4;
+
+struct InputLogHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t startLevel;
+	uint32_t courseCount;
+	uint32_t tickCount;
+	uint64_t finalHash;
+};
+
+class InputRecorder
+{
+public:
+	void begin(int p_startLevel, int p_courseCount);
+	void record(const ShotInput& p_input);
+	bool save(const char* p_filePath, uint64_t p_finalHash) const;
+	uint32_t getTickCount() const
+	{
+		return tickCount;
+	}
+private:
+	std::vector<uint8_t> data;
+	ShotInput last;
+	uint32_t tickCount = 0;
+	uint32_t lastEntryTick = 0;
+	int startLevel = 0;
+	int courseCount = 0;
+};
+
+class InputPlayer
+{
+public:
+	//false if the file is unreadable or holds a session the game can't have recorded
+	bool load(const char* p_filePath);
+	void rewind();
+	bool next(ShotInput& p_input);
+	const InputLogHeader& getHeader() const
+	{
+		return header;
+	}
+private:
+	InputLogHeader header;
+	std::vector<uint8_t> data;
+	size_t cursor = 0;
+	uint32_t tick = 0;
+	uint32_t nextEntryTick = 0;
+	ShotInput current;
+	void readEntryTick();
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <vector>
+
+//runs items [p_begin, p_end) of a parallelFor
+typedef void (*JobFunc)(void* p_data, int p_begin, int p_end);
+
+struct Job
+{
+	JobFunc func;
+	void* data;
+	int begin;
+	int end;
+};
+
+const int JOB_QUEUE_SIZE = 256;
+
+//One worker's jobs. The owner takes from the bottom, idle workers steal from
+//the top; a spinlock is enough since each side only holds it for a copy.
+struct JobQueue
+{
+	Job jobs[JOB_QUEUE_SIZE];
+	int top = 0;
+	int bottom = 0;
+	SDL_SpinLock lock = 0;
+};
+
+//Fork-join pool of worker threads with work stealing. The calling thread
+//takes part in every parallelFor, so with no workers (one core, or a
+//platform without threads) it simply runs everything itself.
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	void start(int p_workerCount);
+	void stop();
+	int getWorkerCount() const
+	{
+		return workers.size();
+	}
+	void parallelFor(int p_count, int p_grain, JobFunc p_func, void* p_data);
+private:
+	static int workerMain(void* p_worker);
+	bool push(int p_queue, const Job& p_job);
+	bool pop(int p_queue, Job& p_job);
+	bool steal(int p_thief, Job& p_job);
+	bool runOne(int p_queue);
+	std::vector<SDL_Thread*> workers;
+	std::vector<JobQueue*> queues; //queue 0 belongs to the thread calling parallelFor
+	SDL_sem* wake;
+	SDL_atomic_t pending;
+	SDL_atomic_t quit;
+};
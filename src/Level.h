@@ -0,0 +1,14 @@
+#pragma once
+
+enum TileType
+{
+	TILE_DARK_32,
+	TILE_DARK_64,
+	TILE_LIGHT_32,
+	TILE_LIGHT_64,
+	TILE_TYPE_COUNT
+};
+
+//size of the tile sprites, including the 3px lip drawn under each block
+int getTileWidth(int p_type);
+int getTileHeight(int p_type);
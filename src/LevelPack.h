@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "CollisionWorld.h"
+
+//Binary course file written by tools/levelc.cpp. Every record is made of
+//4-byte fields and sits at a 4-byte aligned offset from the start of the
+//file, so the game maps the file and reads it in place. Little-endian.
+const char LEVEL_PACK_MAGIC[4] = {'T', 'G', 'L', 'P'};
+const uint32_t LEVEL_PACK_VERSION = 2;
+
+struct PackHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t levelCount;
+	uint32_t levelsOffset;
+};
+
+struct PackCourse
+{
+	float spawnX, spawnY;
+	float holeX, holeY;
+	float boundsX, boundsY, boundsW, boundsH;
+};
+
+struct PackTile
+{
+	float x, y;
+	int32_t type;
+};
+
+struct PackLevel
+{
+	int32_t par;
+	uint32_t courseCount;
+	uint32_t coursesOffset;
+	uint32_t tileCount;
+	uint32_t tilesOffset;
+	float gridOriginX;
+	float gridOriginY;
+	int32_t gridCols;
+	int32_t gridRows;
+	uint32_t boxesOffset; //tileCount SimRects
+	uint32_t boxCellsOffset; //tileCount*2 int32
+	uint32_t cellStartOffset; //gridCols*gridRows + 1 int32
+	uint32_t cellTilesOffset;
+	uint32_t cellTileCount;
+};
+
+class LevelPack
+{
+public:
+	LevelPack();
+	~LevelPack();
+	LevelPack(const LevelPack&) = delete;
+	LevelPack& operator=(const LevelPack&) = delete;
+	bool open(const char* p_filePath);
+	void close();
+	int getLevelCount() const;
+	const PackLevel& getLevel(int p_level) const;
+	const PackCourse* getCourses(const PackLevel& p_level) const;
+	const PackTile* getTiles(const PackLevel& p_level) const;
+	CollisionGrid getGrid(const PackLevel& p_level) const;
+private:
+	bool validate() const;
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "Math.h"
+#include "Session.h"
+#include "Simulation.h"
+
+//Two player versus over the network: player p shoots on course p of a two
+//course Session, and both machines simulate both courses.
+//Only shots cross the wire, as the tick they happen on and the drag vector at
+//release. A shot is played INPUT_SHOT_TICKS long (press, drag, release) on the
+//shooter's course, every other tick of a course is idle.
+//Local shots are scheduled inputDelay ticks ahead so they usually reach the
+//peer in time. Until the peer's shots for a tick are known it is predicted to
+//not shoot; when a shot arrives for a tick already simulated, the session is
+//rolled back to that tick and simulated forward again.
+//Both sides hash the state every HASH_INTERVAL confirmed ticks and compare.
+//On a mismatch the joining player asks for a resync and the host answers with
+//a snapshot of a confirmed tick, each ball delta-encoded against its spawn.
+const int VERSUS_PLAYERS = 2;
+const int MAX_ROLLBACK_TICKS = 240;
+const int HASH_INTERVAL = 60;
+const int HASH_HISTORY = 16;
+//the side running ahead waits a tick at most this often to let the other catch up
+const int TIME_SYNC_TICKS = 8;
+const int INPUT_SHOT_TICKS = 3;
+//how many unacknowledged shots one packet carries
+const int MAX_PACKET_SHOTS = 16;
+
+const uint32_t NET_MAGIC = 0x534c4754; //"TGLS"
+const uint8_t PACKET_INPUT = 1;
+const uint8_t PACKET_SNAPSHOT = 2;
+const uint8_t PACKET_RESYNC = 1;
+
+struct NetShot
+{
+	int32_t tick;
+	int16_t dragX;
+	int16_t dragY;
+};
+
+//a tick's state before it was simulated, kept to roll back to
+struct TickState
+{
+	SessionState state;
+	uint64_t hash;
+};
+
+class Lockstep
+{
+public:
+	Lockstep(Session& p_session, int p_player, int p_inputDelay);
+	//starts over from whatever level the session is on
+	void reset();
+	//schedules the local player's shot, false if it is too soon after the last one
+	bool shoot(Vector2f p_drag);
+	//false while the peer is so far behind that the rollback window would run out
+	bool canAdvance() const;
+	void advance();
+	//how many ticks ahead of the peer this side runs, for keeping both in time
+	int getFrameAdvantage() const;
+	//true when this side should hold back a tick
+	bool shouldWait();
+	int writePacket(uint8_t* p_data, int p_size);
+	void readPacket(const uint8_t* p_data, int p_size);
+	int getTick() const
+	{
+		return simTick;
+	}
+	int getConfirmedTick() const;
+	int getPlayer() const
+	{
+		return player;
+	}
+	bool isConnected() const
+	{
+		return connected;
+	}
+	bool isDesynced() const
+	{
+		return desynced;
+	}
+	int getRollbackCount() const
+	{
+		return rollbacks;
+	}
+	int getResyncCount() const
+	{
+		return resyncs;
+	}
+private:
+	void getInput(const std::vector<NetShot>& p_shots, int p_tick, ShotInput& p_input) const;
+	void simulate();
+	void rollback(int p_tick);
+	void resimulate(int p_fromTick);
+	uint64_t getHash(int p_tick) const;
+	void updateHashes();
+	void checkHash(int p_tick, uint64_t p_hash);
+	int writeSnapshot(uint8_t* p_data, int p_size, int p_tick);
+	void readSnapshot(const uint8_t* p_data, int p_size);
+
+	Session& session;
+	int player;
+	int inputDelay;
+	int simTick = 0;
+	std::vector<TickState> states;
+	std::vector<NetShot> shots[VERSUS_PLAYERS];
+	//every tick up to known has all of the player's shots
+	int localKnown = -1;
+	int remoteKnown = -1;
+	//the peer has every local shot up to this tick
+	int remoteAck = -1;
+	//how far ahead of the peer each side thought it was when it last wrote
+	int localAdvantage = 0;
+	int remoteAdvantage = 0;
+	int lastWaitTick = 0;
+	bool connected = false;
+	//while re-simulating, only events of the peer's ball are new
+	bool resimulating = false;
+	int rollbacks = 0;
+
+	int nextHashTick = HASH_INTERVAL;
+	int hashTicks[HASH_HISTORY];
+	uint64_t hashes[HASH_HISTORY];
+	int remoteHashTick = -1;
+	uint64_t remoteHash = 0;
+	//comparisons before a resync are meaningless
+	int firstValidHashTick = 0;
+	bool desynced = false;
+	//the host answers resync requests at most once per HASH_INTERVAL ticks
+	bool snapshotRequested = false;
+	int lastSnapshotTick = -HASH_INTERVAL;
+	SessionState snapshot;
+	int resyncs = 0;
+};
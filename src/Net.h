@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+const int MAX_PACKET_SIZE = 1200;
+
+//a packet held back by the latency simulator until its time comes
+struct DelayedPacket
+{
+	int64_t due;
+	int size;
+	uint8_t data[MAX_PACKET_SIZE];
+};
+
+//Non-blocking UDP to a single peer. open() binds the local port; a host
+//that was never told its peer answers whoever sent to it first. Bad network
+//conditions can be simulated on the way out: a share of the packets is
+//dropped and the rest are delayed, so two processes on loopback behave like
+//two machines on a poor connection. Not available on the web build.
+class UdpSocket
+{
+public:
+	UdpSocket();
+	~UdpSocket();
+	UdpSocket(const UdpSocket&) = delete;
+	UdpSocket& operator=(const UdpSocket&) = delete;
+	bool open(int p_port);
+	bool setPeer(const char* p_host, int p_port);
+	bool hasPeer() const
+	{
+		return peerKnown;
+	}
+	void close();
+	void send(const uint8_t* p_data, int p_size);
+	//the next packet from the peer, or 0 when there is none waiting
+	int receive(uint8_t* p_data, int p_size);
+	void simulate(float p_lossPercent, int p_latencyMs);
+private:
+	void sendNow(const uint8_t* p_data, int p_size);
+	static int64_t nowMs();
+	intptr_t handle;
+	bool peerKnown;
+	unsigned char peer[32]; //sockaddr_in, kept opaque so the header needs no socket includes
+	float lossPercent;
+	int latencyMs;
+	uint32_t lossSeed;
+	std::vector<DelayedPacket> delayed;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+//Short-lived cosmetic particles, hole-out bursts, bounce dust and trails, one
+//array per component like EntityStore. The arrays are sized once by reserve()
+//and the live particles are always the first count of them: a dead one is
+//replaced by the last, so nothing allocates and update() runs over plain
+//contiguous floats the compiler can vectorize.
+struct ParticleStore
+{
+	void reserve(int p_capacity);
+	void clear()
+	{
+		count = 0;
+	}
+	int size() const
+	{
+		return count;
+	}
+	//false once the store is full, the particle is just not shown
+	bool emit(int p_course, int p_sprite, float p_x, float p_y, float p_velX, float p_velY, float p_life, float p_scale);
+	//p_count particles flying out of (p_x, p_y) in random directions at up to p_speed
+	void burst(int p_course, int p_sprite, float p_x, float p_y, int p_count, float p_speed, float p_life, float p_scale);
+	void update(float p_seconds);
+
+	int count = 0;
+	int capacity = 0;
+	//the fraction of its speed a particle loses each second
+	float drag = 3;
+	uint32_t random = 0x9e3779b9;
+
+	std::vector<float> posX;
+	std::vector<float> posY;
+	std::vector<float> velX;
+	std::vector<float> velY;
+	std::vector<float> age;
+	std::vector<float> life;
+	std::vector<float> scale;
+	std::vector<int> sprite;
+	std::vector<int> course;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+//Scoped timing markers. Each thread records into its own ring buffer with no
+//locking; exportChromeTrace() writes everything as Chrome/Perfetto trace
+//JSON. Recording is switched on at runtime with setProfilerEnabled(), and
+//building with -DTWINI_NO_PROFILER removes the markers entirely.
+
+const int PROFILE_BUFFER_SIZE = 1 << 15;
+const int PROFILE_FRAME_HISTORY = 256;
+
+struct ProfileEvent
+{
+	const char* name;
+	int64_t start;
+	int64_t end;
+};
+
+extern std::atomic<bool> profilerEnabled;
+
+inline bool isProfilerEnabled()
+{
+	return profilerEnabled.load(std::memory_order_relaxed);
+}
+
+void setProfilerEnabled(bool p_enabled);
+int64_t getProfileTime();
+void recordProfileEvent(const char* p_name, int64_t p_start, int64_t p_end);
+void profileFrame();
+float getFrameTimePercentile(float p_percentile);
+bool exportChromeTrace(const char* p_filePath);
+
+class ProfileScope
+{
+public:
+	ProfileScope(const char* p_name)
+	:name(p_name), start(isProfilerEnabled() ? getProfileTime() : -1)
+	{}
+	~ProfileScope()
+	{
+		if (start >= 0)
+		{
+			recordProfileEvent(name, start, getProfileTime());
+		}
+	}
+private:
+	const char* name;
+	int64_t start;
+};
+
+#ifndef TWINI_NO_PROFILER
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(p_name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(p_name)
+#else
+#define PROFILE_SCOPE(p_name)
+#endif
@@ -2,22 +2,110 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_image.h>
+#include <string>
+#include <vector>
 
-#include "Entity.h"
+#include "EntityStore.h"
+#include "ParticleStore.h"
+
+const int FIRST_GLYPH = 32;
+const int GLYPH_COUNT = 127 - FIRST_GLYPH;
+const int GLYPH_ATLAS_WIDTH = 512;
+const unsigned int TEXT_CACHE_SIZE = 64;
+const int ATLAS_PAGE_SIZE = 2048;
+
+//a sub-rect of an atlas page
+struct Sprite
+{
+	SDL_Texture* tex;
+	SDL_Rect frame;
+};
+
+struct AtlasEntry
+{
+	std::string path;
+	Sprite sprite;
+};
+
+//every printable ASCII glyph of one font in one colour, rasterized once
+struct GlyphAtlas
+{
+	TTF_Font* font;
+	SDL_Color color;
+	SDL_Texture* tex;
+	SDL_Rect glyphs[GLYPH_COUNT];
+	int advances[GLYPH_COUNT];
+};
+
+//a string already laid out as quads into its glyph atlas
+struct TextLayout
+{
+	std::string text;
+	int atlas;
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+	int w, h;
+	Uint32 lastUsed;
+};
+
+//where one course is drawn, the same as a setView() call would set
+struct ViewTransform
+{
+	SDL_Rect viewport;
+	float originX;
+	float originY;
+	float scale;
+};
 
 class RenderWindow 
 {
 public:
 	RenderWindow(const char* p_title, int p_w, int p_h);
 	SDL_Texture* loadTexture(const char* p_filePath);
+	bool loadAtlas(const char* const* p_filePaths, int p_count);
+	bool buildAtlas(const char* const* p_names, SDL_Surface* const* p_surfaces, int p_count);
+	Sprite getSprite(const char* p_filePath);
 	void cleanUp();
+	bool setVSync(bool p_vsync);
+	int getRefreshRate();
 	void clear();
-	void render(Entity& p_entity);
-	void render(int x, int y, SDL_Texture* p_tex);
+	void setView(const SDL_Rect& p_viewport, float p_originX, float p_originY, float p_scale, bool p_clip);
+	void resetView();
+	void render(const EntityStore& p_store, const Sprite* p_sprites, int p_kind);
+	void render(const EntityStore& p_store, const Sprite* p_sprites, int p_kind, int p_first, int p_count);
+	void render(const ParticleStore& p_particles, const Sprite* p_sprites, const ViewTransform* p_views);
+	void render(int x, int y, Sprite p_sprite);
 	void render(float p_x, float p_y, const char* p_text, TTF_Font* font, SDL_Color textColor);
 	void renderCenter(float p_x, float p_y, const char* p_text, TTF_Font* font, SDL_Color textColor);
+	SDL_Texture* createLayer();
+	void beginLayer(SDL_Texture* p_layer);
+	void endLayer();
+	void renderLayer(SDL_Texture* p_layer);
 	void display();
 private:
+	int getGlyphAtlas(TTF_Font* font, SDL_Color textColor);
+	TextLayout& getTextLayout(const char* p_text, TTF_Font* font, SDL_Color textColor);
+	void renderText(float p_x, float p_y, TextLayout& p_layout);
+	void batchTexture(SDL_Texture* p_tex);
+	void batchQuad(SDL_Texture* p_tex, const SDL_Rect& p_src, const SDL_Rect& p_dst, float p_angle);
+	void flushBatch();
 	SDL_Window* window;
 	SDL_Renderer* renderer;
+	std::vector<AtlasEntry> atlasEntries;
+	std::vector<SDL_Texture*> atlasPages;
+	SDL_Texture* batchTex = NULL;
+	int batchTexW = 1;
+	int batchTexH = 1;
+	std::vector<SDL_Vertex> batchVertices;
+	std::vector<int> batchIndices;
+	//sprites are drawn at (pos - origin)*scale + viewport corner, clipped to the viewport
+	float viewX = 0;
+	float viewY = 0;
+	float viewOriginX = 0;
+	float viewOriginY = 0;
+	float viewScale = 1;
+	std::vector<GlyphAtlas> glyphAtlases;
+	std::vector<TextLayout> textCache;
+	std::vector<SDL_Vertex> textVertices;
+	Uint32 textCacheClock = 0;
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+
+//A fixed size queue from one writer thread to one reader thread, without
+//locks. Unlike TripleBuffer every value pushed is popped, in order, unless the
+//queue was full, in which case push() drops it instead of waiting. N must be a
+//power of two.
+template <typename T, int N>
+class RingQueue
+{
+public:
+	RingQueue()
+		: head(0), tail(0)
+	{
+	}
+	RingQueue(const RingQueue&) = delete;
+	RingQueue& operator=(const RingQueue&) = delete;
+	bool push(const T& p_value)
+	{
+		unsigned int t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == N)
+		{
+			return false;
+		}
+		slots[t & (N - 1)] = p_value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+	bool pop(T& p_value)
+	{
+		unsigned int h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		p_value = slots[h & (N - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+private:
+	static_assert((N & (N - 1)) == 0, "RingQueue size must be a power of two");
+	T slots[N];
+	//both only ever count up, wrapping together
+	std::atomic<unsigned int> head;
+	std::atomic<unsigned int> tail;
+};
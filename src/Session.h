@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "Ball.h"
+#include "LevelPack.h"
+#include "Simulation.h"
+#include "CollisionWorld.h"
+
+class Session;
+
+//the most courses the game plays at once, so the most an input log can hold
+const int MAX_COURSES = 64;
+
+//everything a tick changes, for rolling back to it
+struct SessionState
+{
+	int level = 0;
+	bool finished = false;
+	std::vector<BallState> balls;
+};
+
+struct SessionStep
+{
+	Session* session;
+	const ShotInput* input;
+};
+
+//Everything one simulation tick reads or writes. The game and headless
+//replays both advance through step(), so they stay in lockstep.
+//Up to MAX_COURSES courses can be played at once off one input; when there are
+//more than the level has, its courses are repeated in order.
+//A tick can also be split up: stepCourse() for every course, in any order
+//and on any thread, then endStep(). Courses only write to their own ball and
+//event list, and endStep() merges the events in course order, so the
+//outcome is the same as step().
+class Session
+{
+public:
+	Session(const LevelPack* p_pack);
+	Session(const Session&) = delete;
+	Session& operator=(const Session&) = delete;
+	void setCourseCount(int p_count, const Ball& p_ball);
+	int getCourseCount() const
+	{
+		return balls.size();
+	}
+	bool loadLevel(int p_level);
+	bool step(const ShotInput& p_input);
+	void stepCourse(int p_course, const ShotInput& p_input);
+	bool endStep();
+	//JobFunc running stepCourse() over a range, p_step is a SessionStep
+	static void stepCourses(void* p_step, int p_begin, int p_end);
+	uint64_t hash() const;
+	void save(SessionState& p_state) const;
+	void restore(const SessionState& p_state);
+	//where p_course's ball starts p_level, for encoding states as changes from it
+	void getSpawnState(int p_level, int p_course, BallState& p_ball) const;
+
+	const LevelPack* pack;
+	int level = 0;
+	int levelCourseCount = 0;
+	bool finished = false;
+	CollisionWorld world;
+	std::vector<Ball> balls;
+	std::vector<Course> courses;
+	std::vector<SimEvent> events;
+	std::vector<std::vector<SimEvent>> courseEvents;
+};
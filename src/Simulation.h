@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "Math.h"
+
+//Headless golf physics. Nothing in here may depend on SDL, so the same code
+//drives the game and batch jobs running without a display.
+
+const float BALL_SIZE = 16;
+
+//courses are authored on a 640x480 playfield
+const float PLAYFIELD_WIDTH = 640;
+const float PLAYFIELD_HEIGHT = 480;
+
+//the physics always advances in steps of SIM_STEP_MS milliseconds
+const double SIM_TICK_RATE = 240;
+const double SIM_STEP_MS = 1000/SIM_TICK_RATE;
+const int MAX_SIM_STEPS_PER_FRAME = 24;
+const int MAX_BOUNCES_PER_STEP = 4;
+//hole, charge, swing, a wall and every tile bounce
+const int MAX_EVENTS_PER_STEP = MAX_BOUNCES_PER_STEP + 4;
+
+struct SimRect
+{
+	float x, y, w, h;
+};
+
+//one ball's part of the playfield, the ball bounces off the edges of bounds
+struct Course
+{
+	SimRect bounds;
+	Vector2f spawn;
+	Vector2f hole;
+};
+
+struct ShotInput
+{
+	bool mouseDown;
+	bool mousePressed;
+	Vector2f mousePos;
+};
+
+enum SimEventType
+{
+	SIM_EVENT_CHARGE,
+	SIM_EVENT_SWING,
+	SIM_EVENT_HOLE,
+	SIM_EVENT_BOUNCE
+};
+
+struct SimEvent
+{
+	SimEventType type;
+	int ball;
+	Vector2f pos;
+};
+
+struct BallState
+{
+	Vector2f pos;
+	Vector2f scale = Vector2f(1, 1);
+	Vector2f velocity;
+	Vector2f target;
+	Vector2f launchedVelocity;
+	float velocity1D = 0;
+	float launchedVelocity1D = 0;
+	Vector2f initialMousePos;
+	bool canMove = true;
+	bool aiming = false;
+	bool playedSwingFx = true;
+	int index = 0;
+	int strokes = 0;
+	int dirX = 1;
+	int dirY = 1;
+	bool win = false;
+};
+
+//every field of a BallState as a 32 bit word, in a fixed order, for hashing and sending
+const int BALL_STATE_WORDS = 22;
+void packBallState(const BallState& p_ball, uint32_t* p_words);
+void unpackBallState(const uint32_t* p_words, BallState& p_ball);
+
+void resetBall(BallState& p_ball, Vector2f p_pos);
+//what holding the mouse does, p_drag being how far it moved since the press
+void aimBall(BallState& p_ball, Vector2f p_drag);
+class CollisionWorld;
+
+void stepBall(BallState& p_ball, double deltaTime, const ShotInput& p_input, const CollisionWorld& p_world, const Course& p_course, std::vector<SimEvent>& p_events);
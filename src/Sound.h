@@ -0,0 +1,81 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+
+#include "RingQueue.h"
+
+enum SoundId
+{
+	SOUND_CHARGE,
+	SOUND_SWING,
+	SOUND_HOLE,
+	SOUND_COUNT
+};
+
+//Loads a sound as PCM already in the mixer's output format. The first run
+//decodes it and writes the result to p_cacheDir; later runs only read that
+//file back. p_cacheDir may be NULL to always decode.
+Mix_Chunk* loadSound(const char* p_filePath, const char* p_cacheDir);
+
+struct SoundRequest
+{
+	int sound;
+	//the course it was triggered on and the ball's x there, for panning; -1 plays it centred
+	int course;
+	float x;
+};
+
+//Carries the sounds triggered during an update to the thread that owns the
+//mixer. A sound played several times before send(), say by every course
+//swinging off the same click, goes out once: panned by its ball when they were
+//all on one course, centred otherwise. Only one thread may play and send at a
+//time: the main one until the simulation thread starts, then that one.
+class SoundQueue
+{
+public:
+	void play(int p_sound, int p_course = -1, float p_x = 0);
+	void send();
+	bool pop(SoundRequest& p_request);
+private:
+	SoundRequest pending[SOUND_COUNT];
+	int pendingCount[SOUND_COUNT] = {};
+	RingQueue<SoundRequest, 64> requests;
+	//a hole-out that found the queue full, played centred once it drains
+	std::atomic<bool> holeDropped{false};
+};
+
+//how a sound competes for voices: a higher priority steals from a lower one
+struct SoundSettings
+{
+	int priority;
+	int maxInstances;
+	int volume;
+};
+
+const int VOICE_COUNT = 8;
+
+//Plays sounds on a fixed number of mixer channels, so however many balls fire
+//at once there is never more than VOICE_COUNT to mix. A sound already playing
+//maxInstances times restarts its oldest instance. Otherwise it takes a free
+//voice, or failing that steals the one of no higher priority that is quietest,
+//then oldest; if every voice plays something more important it is dropped.
+class VoiceManager
+{
+public:
+	void open(const SoundSettings* p_settings);
+	//p_pan goes from 0, all left, to 1, all right; false if the sound was dropped
+	bool play(Mix_Chunk* p_chunk, int p_sound, float p_pan);
+private:
+	struct Voice
+	{
+		int sound = -1;
+		int priority = 0;
+		int loudness = 0;
+		Uint32 started = 0;
+	};
+	Voice voices[VOICE_COUNT];
+	SoundSettings settings[SOUND_COUNT];
+	int voiceCount = 0;
+	Uint32 playCount = 0;
+};
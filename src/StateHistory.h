@@ -0,0 +1,108 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "Session.h"
+#include "Simulation.h"
+
+//Recent play, kept in a fixed size ring so any tick of it can be gone back to.
+//Every HISTORY_SEGMENT_TICKS ticks a segment starts with the session's state,
+//followed by every input that changed during it. A state is a keyframe, each
+//word XORed against the ball's spawn state, or a delta, XORed against the
+//latest keyframe; either way only the bits that differ are stored. A segment
+//whose state is the same as the one before just points back to it, so a
+//still game costs a few bytes a second. The state before every stroke is
+//kept as a keyframe too:
+//  undo() goes back to the start of the last stroke with one decode
+//  seek() decodes a segment and re-simulates at most a segment's worth of ticks
+//Both leave the ticks after them in place, so seeking forward again redoes
+//them, until record() carries on from the earlier tick and drops them.
+const int HISTORY_SEGMENT_TICKS = 240;
+const int HISTORY_SEGMENTS = 1024;
+const uint32_t HISTORY_BYTES = 32*1024;
+const int HISTORY_STROKES = 64;
+
+struct HistorySegment
+{
+	uint32_t start;
+	//where the segment's state is encoded and the keyframe it is a delta of,
+	//the same when it is a keyframe itself
+	uint32_t statePos;
+	uint32_t keyPos;
+};
+
+struct HistoryStroke
+{
+	int tick;
+	uint32_t keyPos;
+};
+
+class StateHistory
+{
+public:
+	//empties the history, which starts from p_session's state
+	void reset(const Session& p_session);
+	//call before stepping p_session with p_input
+	void record(const Session& p_session, const ShotInput& p_input);
+	bool undo(Session& p_session);
+	bool seek(Session& p_session, int p_tick);
+	//the tick p_session is before
+	int getTick() const
+	{
+		return playhead;
+	}
+	int getLatestTick() const
+	{
+		return endTick;
+	}
+	int getOldestTick() const;
+	uint32_t getBytesRecorded() const
+	{
+		return writePos;
+	}
+private:
+	void reserve(uint32_t p_bytes);
+	void beginSegment(const Session& p_session);
+	void writeByte(uint8_t p_byte);
+	void writeInput(const ShotInput& p_input);
+	uint32_t writeState(const std::vector<uint32_t>& p_words, const std::vector<uint32_t>& p_base);
+	void readState(uint32_t& p_pos, std::vector<uint32_t>& p_words, bool p_key) const;
+	void skipState(uint32_t& p_pos) const;
+	void readInput(uint32_t& p_pos, uint8_t p_flags, ShotInput& p_input) const;
+	bool decode(uint32_t p_statePos, uint32_t p_keyPos, std::vector<uint32_t>& p_words) const;
+	void getWords(const Session& p_session, std::vector<uint32_t>& p_words) const;
+	void getSpawnWords(int p_level, std::vector<uint32_t>& p_words) const;
+	void restore(Session& p_session, const std::vector<uint32_t>& p_words);
+	void truncate(int p_tick);
+	bool isHeld(uint32_t p_pos) const;
+	const HistorySegment& getSegment(int p_index) const
+	{
+		return segments[p_index % HISTORY_SEGMENTS];
+	}
+
+	const Session* session = NULL;
+	std::vector<uint8_t> bytes;
+	//the most a single state can take, no write may run into the oldest segment
+	uint32_t maxStateBytes = 0;
+	//positions count every byte ever written, the ring holds the last bytes.size()
+	uint32_t writePos = 0;
+	HistorySegment segments[HISTORY_SEGMENTS];
+	int firstSegment = 0;
+	int segmentCount = 0;
+	HistoryStroke strokes[HISTORY_STROKES];
+	int firstStroke = 0;
+	int strokeCount = 0;
+	int playhead = 0;
+	int endTick = 0;
+	ShotInput lastInput;
+	//after truncating, the input in effect isn't known, so the next one is written
+	bool inputDirty = true;
+	//a keyframe has to be written before there is anything to delta against
+	bool hasKey = false;
+	uint32_t keyPos = 0;
+	std::vector<uint32_t> keyWords;
+	std::vector<uint32_t> lastWords;
+	std::vector<uint32_t> words;
+	std::vector<uint32_t> baseWords;
+	SessionState state;
+};
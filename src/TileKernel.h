@@ -0,0 +1,32 @@
+#pragma once
+
+//Swept ball against a run of tile boxes stored as packed min/max arrays,
+//TILE_BATCH boxes per call. The AVX2 and SSE2 versions do exactly the same
+//float operations as the scalar one, so every version gives identical bits.
+const int TILE_BATCH = 8;
+
+enum TileKernel
+{
+	TILE_KERNEL_SCALAR,
+	TILE_KERNEL_SSE2,
+	TILE_KERNEL_AVX2,
+	TILE_KERNEL_COUNT
+};
+
+struct TileSweep
+{
+	float minX, minY;
+	float maxX, maxY;
+	float deltaX, deltaY;
+};
+
+//Tests boxes 0..p_count-1 (p_count <= TILE_BATCH; the arrays must still be
+//readable for TILE_BATCH floats). Bit i of the result masks is set when the
+//sweep hits box i first on the x or y axis, and p_entry[i] is its entry time.
+typedef void (*TileSweepFunc)(const TileSweep& p_sweep, const float* p_minX, const float* p_minY, const float* p_maxX, const float* p_maxY, int p_count, float* p_entry, unsigned int& p_xMask, unsigned int& p_yMask);
+
+//the best kernel the CPU supports, picked at startup
+TileSweepFunc getTileSweep();
+int getTileKernel();
+//for comparing kernels; falls back to the best supported one below p_kernel
+void setTileKernel(int p_kernel);
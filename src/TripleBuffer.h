@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+
+//Hands whole values from one writer thread to one reader thread without locks
+//or copies. There are three slots: the writer fills the back one and swaps it
+//into the middle, and the reader swaps the middle out for its front one when
+//something newer was published. Neither ever waits for the other; a reader
+//slower than the writer just skips to the newest value.
+template <typename T>
+class TripleBuffer
+{
+public:
+	static const int SLOT_COUNT = 3;
+	TripleBuffer()
+		: middle(1)
+	{
+	}
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+	//the writer's slot, still holding whatever it was three publishes ago
+	T& getBack()
+	{
+		return slots[back];
+	}
+	void publish()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+	//makes the newest published value the front one, false if nothing was published since
+	bool acquire()
+	{
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+		{
+			return false;
+		}
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+	const T& getFront() const
+	{
+		return slots[front];
+	}
+	//for setting every slot up before either thread uses the buffer
+	T& getSlot(int p_index)
+	{
+		return slots[p_index];
+	}
+private:
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;
+	T slots[SLOT_COUNT];
+	int back = 0;
+	int front = 2;
+	//the middle slot's index, with FRESH set until the reader takes it
+	std::atomic<int> middle;
+};
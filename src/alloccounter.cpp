@@ -0,0 +1,75 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocationCount(0);
+
+uint64_t getAllocationCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+#ifndef TWINI_NO_ALLOC_COUNTER
+static void* countedAlloc(std::size_t p_size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(p_size > 0 ? p_size : 1);
+}
+
+void* operator new(std::size_t p_size)
+{
+	void* p = countedAlloc(p_size);
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](std::size_t p_size)
+{
+	return operator new(p_size);
+}
+
+void* operator new(std::size_t p_size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(p_size);
+}
+
+void* operator new[](std::size_t p_size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(p_size);
+}
+
+void operator delete(void* p_ptr) noexcept
+{
+	std::free(p_ptr);
+}
+
+void operator delete[](void* p_ptr) noexcept
+{
+	std::free(p_ptr);
+}
+
+void operator delete(void* p_ptr, std::size_t) noexcept
+{
+	std::free(p_ptr);
+}
+
+void operator delete[](void* p_ptr, std::size_t) noexcept
+{
+	std::free(p_ptr);
+}
+
+void operator delete(void* p_ptr, const std::nothrow_t&) noexcept
+{
+	std::free(p_ptr);
+}
+
+void operator delete[](void* p_ptr, const std::nothrow_t&) noexcept
+{
+	std::free(p_ptr);
+}
+#endif
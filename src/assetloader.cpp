@@ -0,0 +1,142 @@
+#include "AssetLoader.h"
+#include "Sound.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
+#include <iostream>
+
+AssetLoader::AssetLoader()
+{
+	SDL_AtomicSet(&nextJob, 0);
+	SDL_AtomicSet(&doneCount, 0);
+}
+
+AssetLoader::~AssetLoader()
+{
+	wait();
+	for (AssetJob* job : jobs)
+	{
+		SDL_FreeSurface(job->surface);
+		if (job->chunk != NULL)
+			Mix_FreeChunk(job->chunk);
+		delete job;
+	}
+}
+
+int AssetLoader::queue(const char* p_filePath, int p_type)
+{
+	AssetJob* job = new AssetJob();
+	job->path = p_filePath;
+	job->type = p_type;
+	job->surface = NULL;
+	job->chunk = NULL;
+	SDL_AtomicSet(&job->ready, 0);
+	jobs.push_back(job);
+	return jobs.size() - 1;
+}
+
+int AssetLoader::queueImage(const char* p_filePath)
+{
+	return queue(p_filePath, ASSET_IMAGE);
+}
+
+int AssetLoader::queueSound(const char* p_filePath)
+{
+	return queue(p_filePath, ASSET_SOUND);
+}
+
+void AssetLoader::setSoundCacheDir(const char* p_cacheDir)
+{
+	soundCacheDir = p_cacheDir != NULL ? p_cacheDir : "";
+}
+
+int AssetLoader::workerMain(void* p_loader)
+{
+	((AssetLoader*)p_loader)->runJobs();
+	return 0;
+}
+
+void AssetLoader::runJobs()
+{
+	int i;
+	while ((i = SDL_AtomicAdd(&nextJob, 1)) < (int)jobs.size())
+	{
+		AssetJob* job = jobs[i];
+		if (job->type == ASSET_IMAGE)
+		{
+			job->surface = IMG_Load(job->path.c_str());
+			if (job->surface == NULL)
+				std::cout << "Failed to load texture. Error: " << SDL_GetError() << std::endl;
+		}
+		else
+		{
+			job->chunk = loadSound(job->path.c_str(), soundCacheDir.empty() ? NULL : soundCacheDir.c_str());
+			if (job->chunk == NULL)
+				std::cout << "Failed to load sound. Error: " << SDL_GetError() << std::endl;
+		}
+		SDL_AtomicSet(&job->ready, 1);
+		SDL_AtomicAdd(&doneCount, 1);
+	}
+}
+
+void AssetLoader::start()
+{
+	int threadCount = SDL_min(SDL_GetCPUCount(), (int)jobs.size());
+	for (int i = 0; i < threadCount; i++)
+	{
+		SDL_Thread* thread = SDL_CreateThread(workerMain, "AssetLoader", this);
+		if (thread == NULL)
+		{
+			break;
+		}
+		workers.push_back(thread);
+	}
+
+	//no threads on this platform: decode everything now
+	if (workers.empty())
+	{
+		runJobs();
+	}
+}
+
+bool AssetLoader::isReady(int p_handle)
+{
+	return SDL_AtomicGet(&jobs[p_handle]->ready) != 0;
+}
+
+bool AssetLoader::isDone()
+{
+	return SDL_AtomicGet(&doneCount) == (int)jobs.size();
+}
+
+SDL_Surface* AssetLoader::takeSurface(int p_handle)
+{
+	if (!isReady(p_handle))
+	{
+		return NULL;
+	}
+	SDL_Surface* surface = jobs[p_handle]->surface;
+	jobs[p_handle]->surface = NULL;
+	return surface;
+}
+
+Mix_Chunk* AssetLoader::takeChunk(int p_handle)
+{
+	if (!isReady(p_handle))
+	{
+		return NULL;
+	}
+	Mix_Chunk* chunk = jobs[p_handle]->chunk;
+	jobs[p_handle]->chunk = NULL;
+	return chunk;
+}
+
+void AssetLoader::wait()
+{
+	for (SDL_Thread* thread : workers)
+	{
+		SDL_WaitThread(thread, NULL);
+	}
+	workers.clear();
+}
@@ -1,200 +1,100 @@
 #include "Ball.h"
-#include "Entity.h"
+#include "EntityStore.h"
 #include "Math.h"
-#include "Tile.h"
-#include "Hole.h"
+#include "Simulation.h"
+#include "CollisionWorld.h"
+#include "Profiler.h"
 
 #include <vector>
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_ttf.h>
-#include <SDL2/SDL_mixer.h>
+#include <cmath>
 
+//one entity per part of the ball, indexed like sprites/entities
+const int ballParts[BALL_ENTITY_COUNT] = {ENTITY_BALL, ENTITY_BALL_SHADOW, ENTITY_POINT, ENTITY_POWERBAR_FG, ENTITY_POWERBAR_BG, ENTITY_POWERBAR_OVERLAY};
 
-Ball::Ball(Vector2f p_pos, SDL_Texture* p_tex, SDL_Texture* p_pointTex, SDL_Texture* p_powerMTexFG, SDL_Texture* p_powerMTexBG, int p_index)
-:Entity(p_pos, p_tex)
+Ball::Ball(int p_index, int p_sprite, int p_shadowSprite, int p_pointSprite, int p_powerMSpriteFG, int p_powerMSpriteBG, int p_powerMSpriteOverlay)
 {
-    index = p_index;
-    points.push_back(Entity(Vector2f(-64, -64), p_pointTex));
-    powerBar.push_back(Entity(Vector2f(-64, -64), p_powerMTexBG));
-    powerBar.push_back(Entity(Vector2f(-64, -64), p_powerMTexFG));
+    state.index = p_index;
+    sprites[0] = p_sprite;
+    sprites[1] = p_shadowSprite;
+    sprites[2] = p_pointSprite;
+    sprites[3] = p_powerMSpriteFG;
+    sprites[4] = p_powerMSpriteBG;
+    sprites[5] = p_powerMSpriteOverlay;
+    for (int i = 0; i < BALL_ENTITY_COUNT; i++)
+    {
+        entities[i] = -1;
+    }
 }
 
-void Ball::setVelocity(float x, float y)
+void Ball::spawn(EntityStore& p_store)
 {
-    velocity.x = x;
-    velocity.y = y;
+    for (int i = 0; i < BALL_ENTITY_COUNT; i++)
+    {
+        entities[i] = p_store.add(ballParts[i], sprites[i], state.pos);
+    }
 }
 
-void Ball::setLaunchedVelocity(float x, float y)
+void Ball::reset(Vector2f p_pos)
 {
-    launchedVelocity.x = x;
-    launchedVelocity.y = y;
+    resetBall(state, p_pos);
+    previousState = state;
 }
 
-void Ball::setInitialMousePos(float x, float y)
+void Ball::setState(const BallState& p_state)
 {
-    initialMousePos.x = x;
-    initialMousePos.y = y;
+    state = p_state;
+    previousState = p_state;
 }
 
-void Ball::setWin(bool p_win)
+void Ball::update(const ShotInput& p_input, const CollisionWorld& p_world, const Course& p_course, std::vector<SimEvent>& p_events)
 {
-    win = p_win;
+    PROFILE_SCOPE("Ball::update");
+    previousState = state;
+    stepBall(state, SIM_STEP_MS, p_input, p_world, p_course, p_events);
 }
 
-void Ball::update(double deltaTime, bool mouseDown, bool mousePressed, std::vector<Tile> tiles,std::vector<Hole> holes, Mix_Chunk* chargeSfx, Mix_Chunk* swingSfx, Mix_Chunk* holeSfx)
-{   
-    if (win)
+void Ball::interpolate(EntityStore& p_store, float p_alpha)
+{
+    int ball = entities[0];
+    int shadow = entities[1];
+    int point = entities[2];
+    int powerBarFG = entities[3];
+    int powerBarBG = entities[4];
+    int overlay = entities[5];
+
+    float x = previousState.pos.x + (state.pos.x - previousState.pos.x)*p_alpha;
+    float y = previousState.pos.y + (state.pos.y - previousState.pos.y)*p_alpha;
+    p_store.posX[ball] = x;
+    p_store.posY[ball] = y;
+    p_store.velX[ball] = state.velocity.x;
+    p_store.velY[ball] = state.velocity.y;
+    p_store.scaleX[ball] = previousState.scale.x + (state.scale.x - previousState.scale.x)*p_alpha;
+    p_store.scaleY[ball] = previousState.scale.y + (state.scale.y - previousState.scale.y)*p_alpha;
+
+    p_store.posX[shadow] = x;
+    p_store.posY[shadow] = y + 4;
+    p_store.flags[shadow] = state.win ? ENTITY_HIDDEN : 0;
+
+    unsigned int aimFlags = state.aiming ? 0 : ENTITY_HIDDEN;
+    p_store.flags[point] = aimFlags;
+    p_store.flags[powerBarBG] = aimFlags;
+    p_store.flags[powerBarFG] = aimFlags;
+    p_store.flags[overlay] = aimFlags;
+    if (!state.aiming)
     {
-        if (getPos().x < target.x)
-        {
-            setPos(getPos().x += 0.1*deltaTime, getPos().y);
-        }
-        else if (getPos().x > target.x)
-        {
-            setPos(getPos().x -= 0.1*deltaTime, getPos().y);
-        }
-        if (getPos().y < target.y)
-        {
-            setPos(getPos().x, getPos().y += 0.1*deltaTime);
-        }
-        else if (getPos().y > target.y)
-        {
-            setPos(getPos().x, getPos().y -= 0.1*deltaTime);
-        }
-        setScale(getScale().x - 0.001*deltaTime, getScale().y - 0.001*deltaTime);
         return;
     }
-    
-    for (Hole h : holes)
-    {
-        if (getPos().x + 4 > h.getPos().x && getPos().x + 16 < h.getPos().x + 20 && getPos().y + 4 > h.getPos().y && getPos().y + 16 < h.getPos().y + 20)
-        {
-            Mix_PlayChannel(-1, holeSfx, 0);
-            setWin(true);
-            target.x = h.getPos().x ;
-            target.y = h.getPos().y + 3;
-        }
-    }
-
-    if (mousePressed && canMove)
-    {
-        Mix_PlayChannel(-1, chargeSfx, 0);
-        playedSwingFx = false;
-        int mouseX = 0;
-	    int mouseY = 0;
-	    SDL_GetMouseState(&mouseX, &mouseY);
-        setInitialMousePos(mouseX, mouseY);
-    }
-    if (mouseDown && canMove)
-    {
-        
-        int mouseX = 0;
-	    int mouseY = 0;
-	    SDL_GetMouseState(&mouseX, &mouseY);
-        setVelocity((mouseX - getInitialMousePos().x)/-150, (mouseY - getInitialMousePos().y)/-150);
-        setLaunchedVelocity((mouseX - getInitialMousePos().x)/-150, (mouseY - getInitialMousePos().y)/-150);
-        velocity1D = SDL_sqrt(SDL_pow(abs(getVelocity().x), 2) + SDL_pow(abs(getVelocity().y), 2));
-        launchedVelocity1D = velocity1D;
- 
-        points.at(0).setPos(getPos().x, getPos().y + 8 - 32);
-        points.at(0).setAngle(SDL_atan2(velocity.y, velocity.x)*(180/3.1415) + 90);
-
-        dirX = velocity.x/abs(velocity.x);
-        dirY = velocity.y/abs(velocity.y);
-
-        powerBar.at(0).setPos(getPos().x + 32 + 8, getPos().y - 32);
-        powerBar.at(1).setPos(getPos().x + 32 + 8 + 4, getPos().y - 32 + 4 + 32 - 32*powerBar.at(1).getScale().y);
-        if (velocity1D > 1)
-        {
-            velocity1D = 1;
-            launchedVelocity1D = 1;
-        }
-        powerBar.at(1).setScale(1, velocity1D/1);
-    }
-    else
-    {
-        if (!playedSwingFx)
-        {
-            Mix_PlayChannel(-1, swingSfx, 0);
-            playedSwingFx = true;
-            strokes++;
-        }
-        points.at(0).setPos(-64, -64);
-        powerBar.at(0).setPos(-64, -64);
-        powerBar.at(1).setPos(-64, -64);
-        canMove = false;
-        setPos(getPos().x + getVelocity().x*deltaTime, getPos().y + getVelocity().y*deltaTime);
-        if (getVelocity().x > 0.0001 || getVelocity().x < -0.0001 || getVelocity().y > 0.0001 || getVelocity().y < -0.0001)
-        {
-            //float xDir = velocity.x/abs(velocity.x);
-            //float yDir = velocity.y/abs(velocity.y);
 
-            //velocity.x = (abs(velocity.x) - friction*deltaTime)*xDir;
-            //velocity.y = (abs(velocity.y) - friction*deltaTime)*yDir;
-            if (velocity1D > 0)
-            {
-                velocity1D -= friction*deltaTime;
-            }
-            else
-            {
-                velocity1D = 0;
-            }
-            velocity.x = (velocity1D/launchedVelocity1D)*abs(launchedVelocity.x)*dirX;
-            velocity.y = (velocity1D/launchedVelocity1D)*abs(launchedVelocity.y)*dirY;
+    p_store.posX[point] = x;
+    p_store.posY[point] = y + 8 - 32;
+    p_store.angle[point] = std::atan2(state.velocity.y, state.velocity.x)*(180/3.1415) + 90;
 
+    p_store.posX[powerBarBG] = x + 32 + 8;
+    p_store.posY[powerBarBG] = y - 32;
+    p_store.posX[overlay] = x + 32 + 8;
+    p_store.posY[overlay] = y - 32;
 
-        }
-        else
-        {
-            setVelocity(0,0);
-            int mouseX = 0;
-	        int mouseY = 0;
-            SDL_GetMouseState(&mouseX, &mouseY);
-            setInitialMousePos(mouseX, mouseY);
-            canMove = true;
-        }
-
-        if (getPos().x + getCurrentFrame().w > 640/(2 - index))
-        {
-            setVelocity(-abs(getVelocity().x), getVelocity().y);
-            dirX = -1;
-        }
-        else if (getPos().x < 0 + (index*320))
-        {
-            setVelocity(abs(getVelocity().x), getVelocity().y);
-            dirX = 1;
-        }
-        else if (getPos().y + getCurrentFrame().h > 480)
-        {
-            setVelocity(getVelocity().x, -abs(getVelocity().y));
-            dirY = -1;
-        }
-        else if (getPos().y < 0)
-        {
-            setVelocity(getVelocity().x, abs(getVelocity().y));
-            dirY = 1;
-        }
-
-        for (Tile& t : tiles)
-	    { 
-		    float newX = getPos().x + getVelocity().x*deltaTime;
-            float newY = getPos().y;
-            if (newX + 16 > t.getPos().x && newX < t.getPos().x + t.getCurrentFrame().w && newY + 16 > t.getPos().y && newY < t.getPos().y + t.getCurrentFrame().h - 3)
-            {
-                setVelocity(getVelocity().x*-1, getVelocity().y);
-                dirX *= -1;
-            }
-
-            newX = getPos().x;
-            newY = getPos().y + getVelocity().y*deltaTime;
-            if (newX + 16 > t.getPos().x && newX < t.getPos().x + t.getCurrentFrame().w && newY + 16 > t.getPos().y && newY < t.getPos().y + t.getCurrentFrame().h - 3)
-            {
-                setVelocity(getVelocity().x, getVelocity().y*-1);
-                dirY *= -1;
-            }
-	    }
-    }
-    
-}
\ No newline at end of file
+    p_store.scaleY[powerBarFG] = state.velocity1D/1;
+    p_store.posX[powerBarFG] = x + 32 + 8 + 4;
+    p_store.posY[powerBarFG] = y - 32 + 4 + 32 - 32*p_store.scaleY[powerBarFG];
+}
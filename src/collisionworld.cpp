@@ -0,0 +1,211 @@
+#include "CollisionWorld.h"
+#include "Math.h"
+#include "Simulation.h"
+#include "TileKernel.h"
+
+#include <vector>
+#include <cmath>
+
+CollisionWorld::CollisionWorld()
+{
+	grid.originX = 0;
+	grid.originY = 0;
+	grid.cols = 0;
+	grid.rows = 0;
+	grid.boxCount = 0;
+	grid.boxes = NULL;
+	grid.boxCells = NULL;
+	grid.cellStart = NULL;
+	grid.cellTiles = NULL;
+}
+
+int CollisionWorld::cellX(float x) const
+{
+	int c = (int)std::floor((x - grid.originX)/COLLISION_CELL_SIZE);
+	return c < 0 ? 0 : (c >= grid.cols ? grid.cols - 1 : c);
+}
+
+int CollisionWorld::cellY(float y) const
+{
+	int c = (int)std::floor((y - grid.originY)/COLLISION_CELL_SIZE);
+	return c < 0 ? 0 : (c >= grid.rows ? grid.rows - 1 : c);
+}
+
+void CollisionWorld::view(const CollisionGrid& p_grid)
+{
+	boxes.clear();
+	boxCells.clear();
+	cellStart.clear();
+	cellTiles.clear();
+	grid = p_grid;
+	packCells();
+}
+
+void CollisionWorld::build(const std::vector<SimRect>& p_tiles)
+{
+	boxes.clear();
+	boxCells.clear();
+	cellStart.clear();
+	cellTiles.clear();
+	grid.originX = 0;
+	grid.originY = 0;
+	grid.cols = 0;
+	grid.rows = 0;
+	grid.boxCount = 0;
+
+	if (!p_tiles.empty())
+	{
+		float maxX = p_tiles[0].x;
+		float maxY = p_tiles[0].y;
+		grid.originX = p_tiles[0].x;
+		grid.originY = p_tiles[0].y;
+		for (const SimRect& t : p_tiles)
+		{
+			SimRect box = t;
+			box.h -= TILE_LIP;
+			boxes.push_back(box);
+			grid.originX = std::fmin(grid.originX, box.x);
+			grid.originY = std::fmin(grid.originY, box.y);
+			maxX = std::fmax(maxX, box.x + box.w);
+			maxY = std::fmax(maxY, box.y + box.h);
+		}
+		grid.cols = (int)std::ceil((maxX - grid.originX)/COLLISION_CELL_SIZE) + 1;
+		grid.rows = (int)std::ceil((maxY - grid.originY)/COLLISION_CELL_SIZE) + 1;
+		grid.boxCount = boxes.size();
+
+		//counting pass, then fill, so every cell's tiles are contiguous
+		int cols = grid.cols;
+		cellStart.assign(cols*grid.rows + 1, 0);
+		for (const SimRect& b : boxes)
+		{
+			for (int y = cellY(b.y); y <= cellY(b.y + b.h); y++)
+				for (int x = cellX(b.x); x <= cellX(b.x + b.w); x++)
+					cellStart[y*cols + x + 1]++;
+		}
+		for (int i = 0; i < cols*grid.rows; i++)
+		{
+			cellStart[i + 1] += cellStart[i];
+		}
+
+		std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+		cellTiles.resize(cellStart.back());
+		for (unsigned int i = 0; i < boxes.size(); i++)
+		{
+			const SimRect& b = boxes[i];
+			boxCells.push_back(cellX(b.x));
+			boxCells.push_back(cellY(b.y));
+			for (int y = cellY(b.y); y <= cellY(b.y + b.h); y++)
+				for (int x = cellX(b.x); x <= cellX(b.x + b.w); x++)
+					cellTiles[fill[y*cols + x]++] = i;
+		}
+	}
+
+	grid.boxes = boxes.data();
+	grid.boxCells = boxCells.data();
+	grid.cellStart = cellStart.data();
+	grid.cellTiles = cellTiles.data();
+	packCells();
+}
+
+//makes room for a view() of a grid with up to p_cellTileCount cell entries,
+//so switching between levels of a pack never allocates
+void CollisionWorld::reserve(int p_cellTileCount)
+{
+	cellMinX.reserve(p_cellTileCount + TILE_BATCH);
+	cellMinY.reserve(p_cellTileCount + TILE_BATCH);
+	cellMaxX.reserve(p_cellTileCount + TILE_BATCH);
+	cellMaxY.reserve(p_cellTileCount + TILE_BATCH);
+}
+
+//padded by a whole batch so the kernel can always load TILE_BATCH floats
+void CollisionWorld::packCells()
+{
+	int count = grid.boxCount > 0 ? grid.cellStart[grid.cols*grid.rows] : 0;
+	cellMinX.assign(count + TILE_BATCH, 0);
+	cellMinY.assign(count + TILE_BATCH, 0);
+	cellMaxX.assign(count + TILE_BATCH, 0);
+	cellMaxY.assign(count + TILE_BATCH, 0);
+	for (int i = 0; i < count; i++)
+	{
+		const SimRect& b = grid.boxes[grid.cellTiles[i]];
+		cellMinX[i] = b.x;
+		cellMinY[i] = b.y;
+		cellMaxX[i] = b.x + b.w;
+		cellMaxY[i] = b.y + b.h;
+	}
+}
+
+bool CollisionWorld::sweep(Vector2f p_pos, Vector2f p_size, Vector2f p_delta, SweepHit& p_hit) const
+{
+	if (grid.boxCount == 0)
+	{
+		return false;
+	}
+
+	float minX = std::fmin(p_pos.x, p_pos.x + p_delta.x);
+	float minY = std::fmin(p_pos.y, p_pos.y + p_delta.y);
+	float maxX = std::fmax(p_pos.x, p_pos.x + p_delta.x) + p_size.x;
+	float maxY = std::fmax(p_pos.y, p_pos.y + p_delta.y) + p_size.y;
+	int x0 = cellX(minX);
+	int y0 = cellY(minY);
+	int x1 = cellX(maxX);
+	int y1 = cellY(maxY);
+
+	TileSweep s;
+	s.minX = p_pos.x;
+	s.minY = p_pos.y;
+	s.maxX = p_pos.x + p_size.x;
+	s.maxY = p_pos.y + p_size.y;
+	s.deltaX = p_delta.x;
+	s.deltaY = p_delta.y;
+	TileSweepFunc tileSweep = getTileSweep();
+
+	bool found = false;
+	p_hit.time = 1;
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			int cell = y*grid.cols + x;
+			int end = grid.cellStart[cell + 1];
+			for (int first = grid.cellStart[cell]; first < end; first += TILE_BATCH)
+			{
+				int count = end - first < TILE_BATCH ? end - first : TILE_BATCH;
+				float entries[TILE_BATCH];
+				unsigned int xMask, yMask;
+				tileSweep(s, &cellMinX[first], &cellMinY[first], &cellMaxX[first], &cellMaxY[first], count, entries, xMask, yMask);
+				unsigned int hits = xMask | yMask;
+				for (int lane = 0; hits != 0; lane++, hits >>= 1)
+				{
+					if (!(hits & 1))
+					{
+						continue;
+					}
+					int t = grid.cellTiles[first + lane];
+					int boxX = grid.boxCells[t*2];
+					int boxY = grid.boxCells[t*2 + 1];
+					//a tile spanning several cells is only tested in the first one the query visits
+					if ((boxX > x0 ? boxX : x0) != x || (boxY > y0 ? boxY : y0) != y)
+					{
+						continue;
+					}
+
+					float entry = entries[lane];
+					if (entry > p_hit.time)
+					{
+						continue;
+					}
+					if (found && entry == p_hit.time && t > p_hit.tile)
+					{
+						continue;
+					}
+					found = true;
+					p_hit.time = entry < 0 ? 0 : entry;
+					p_hit.axis = (xMask >> lane) & 1 ? 0 : 1;
+					p_hit.tile = t;
+				}
+			}
+		}
+	}
+	return found;
+}
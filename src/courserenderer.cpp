@@ -0,0 +1,334 @@
+#include "CourseRenderer.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "Profiler.h"
+
+const char* spritePaths[SPRITE_COUNT] = {
+	"res/gfx/ball.png",
+	"res/gfx/hole.png",
+	"res/gfx/point.png",
+	"res/gfx/tile32_dark.png",
+	"res/gfx/tile64_dark.png",
+	"res/gfx/tile32_light.png",
+	"res/gfx/tile64_light.png",
+	"res/gfx/ball_shadow.png",
+	"res/gfx/bg.png",
+	"res/gfx/UI_bg.png",
+	"res/gfx/levelText_bg.png",
+	"res/gfx/powermeter_fg.png",
+	"res/gfx/powermeter_bg.png",
+	"res/gfx/powermeter_overlay.png",
+	"res/gfx/logo.png",
+	"res/gfx/click2start.png",
+	"res/gfx/end.png",
+	"res/gfx/splashBg.png",
+};
+
+const int tileSprites[TILE_TYPE_COUNT] = {SPRITE_TILE_DARK_32, SPRITE_TILE_DARK_64, SPRITE_TILE_LIGHT_32, SPRITE_TILE_LIGHT_64};
+
+//drawn into the static layer, clipped to each course's viewport
+static const int staticLayers[] = {ENTITY_HOLE, ENTITY_TILE};
+//draw order of the balls over it, back to front, clipped the same way
+static const int entityLayers[] = {ENTITY_BALL_SHADOW, ENTITY_POINT, ENTITY_BALL};
+//drawn over every course afterwards so the bar can stick out of its viewport
+static const int overlayLayers[] = {ENTITY_POWERBAR_BG, ENTITY_POWERBAR_FG, ENTITY_POWERBAR_OVERLAY};
+
+static const SDL_Color white = { 255, 255, 255 };
+static const SDL_Color black = { 0, 0, 0 };
+
+const float TRAIL_INTERVAL = 1/60.0f;
+//in pixels per millisecond, like the ball's velocity
+const float TRAIL_MIN_SPEED = 0.05f;
+
+Ball createBall()
+{
+	return Ball(0, SPRITE_BALL, SPRITE_BALL_SHADOW, SPRITE_POINT, SPRITE_POWERMETER_FG, SPRITE_POWERMETER_BG, SPRITE_POWERMETER_OVERLAY);
+}
+
+void reserveEntities(const LevelPack& p_pack, int p_courseCount, EntityStore& p_entities)
+{
+	int levelEntities = 0;
+	for (int i = 0; i < p_pack.getLevelCount(); i++)
+	{
+		const PackLevel& data = p_pack.getLevel(i);
+		levelEntities = SDL_max(levelEntities, (int)(data.courseCount + data.tileCount));
+	}
+	p_entities.reserve(levelEntities + p_courseCount*BALL_ENTITY_COUNT);
+}
+
+int loadLevelEntities(const LevelPack& p_pack, Session& p_session, EntityStore& p_entities)
+{
+	const PackLevel& data = p_pack.getLevel(p_session.level);
+	const PackCourse* courses = p_pack.getCourses(data);
+	const PackTile* levelTiles = p_pack.getTiles(data);
+
+	p_entities.clear();
+	for (uint32_t i = 0; i < data.courseCount; i++)
+	{
+		p_entities.add(ENTITY_HOLE, SPRITE_HOLE, Vector2f(courses[i].holeX, courses[i].holeY));
+	}
+	for (uint32_t i = 0; i < data.tileCount; i++)
+	{
+		int type = levelTiles[i].type;
+		if (type < 0 || type >= TILE_TYPE_COUNT)
+		{
+			type = TILE_DARK_32;
+		}
+		p_entities.add(ENTITY_TILE, tileSprites[type], Vector2f(levelTiles[i].x, levelTiles[i].y));
+	}
+	int levelEntityCount = p_entities.size();
+	for (Ball& b : p_session.balls)
+	{
+		b.spawn(p_entities);
+		b.interpolate(p_entities, 1);
+	}
+	return levelEntityCount;
+}
+
+void reserveFrame(const LevelPack& p_pack, int p_courseCount, FrameSnapshot& p_frame)
+{
+	reserveEntities(p_pack, p_courseCount, p_frame.entities);
+	p_frame.bounds.reserve(p_courseCount);
+}
+
+void copySession(const Session& p_session, const EntityStore& p_entities, int p_levelEntityCount, FrameSnapshot& p_frame)
+{
+	//the snapshot's arrays keep their capacity, so after reserveFrame() this
+	//copies without allocating
+	p_frame.entities = p_entities;
+	p_frame.levelEntityCount = p_levelEntityCount;
+	p_frame.level = p_session.level;
+	p_frame.levelCourseCount = p_session.levelCourseCount;
+	p_frame.bounds.resize(p_session.getCourseCount());
+	for (int i = 0; i < p_session.getCourseCount(); i++)
+	{
+		p_frame.bounds[i] = p_session.courses[i].bounds;
+	}
+	//the HUD text is formatted into a fixed buffer, so it never allocates
+	int biggestStroke = 0;
+	for (const Ball& b : p_session.balls)
+	{
+		biggestStroke = SDL_max(biggestStroke, b.getState().strokes);
+	}
+	SDL_snprintf(p_frame.strokeText, sizeof(p_frame.strokeText), "STROKES: %d", biggestStroke);
+}
+
+void CourseRenderer::init(RenderWindow* p_window, const Sprite* p_sprites, TTF_Font* p_font24, TTF_Font* p_font32, TTF_Font* p_font48, int p_courseCount)
+{
+	window = p_window;
+	sprites = p_sprites;
+	font24 = p_font24;
+	font32 = p_font32;
+	font48 = p_font48;
+	courseCount = p_courseCount;
+	views.resize(courseCount);
+	trailTimes.resize(courseCount);
+	particles.reserve(PARTICLE_CAPACITY);
+	staticLayer = window->createLayer();
+}
+
+void CourseRenderer::cleanUp()
+{
+	if (staticLayer != NULL)
+	{
+		SDL_DestroyTexture(staticLayer);
+		staticLayer = NULL;
+	}
+}
+
+//picks the column count that shows the courses biggest, each course scaled
+//uniformly and centred in its cell
+void CourseRenderer::layoutCourses(const FrameSnapshot& p_frame)
+{
+	const SimRect& bounds = p_frame.bounds[0];
+	int bestCols = 1;
+	float bestScale = 0;
+	for (int cols = 1; cols <= courseCount; cols++)
+	{
+		int rows = (courseCount + cols - 1)/cols;
+		float scale = SDL_min(PLAYFIELD_WIDTH/cols/bounds.w, PLAYFIELD_HEIGHT/rows/bounds.h);
+		if (scale > bestScale)
+		{
+			bestScale = scale;
+			bestCols = cols;
+		}
+	}
+
+	int rows = (courseCount + bestCols - 1)/bestCols;
+	float cellW = PLAYFIELD_WIDTH/bestCols;
+	float cellH = PLAYFIELD_HEIGHT/rows;
+	for (int i = 0; i < courseCount; i++)
+	{
+		const SimRect& b = p_frame.bounds[i];
+		ViewTransform& view = views[i];
+		view.scale = SDL_min(cellW/b.w, cellH/b.h);
+		view.viewport.w = b.w*view.scale;
+		view.viewport.h = b.h*view.scale;
+		view.viewport.x = (i % bestCols)*cellW + (cellW - view.viewport.w)/2;
+		view.viewport.y = (i/bestCols)*cellH + (cellH - view.viewport.h)/2;
+		view.originX = b.x;
+		view.originY = b.y;
+	}
+}
+
+//p_hudText is empty on the end screen, which has no HUD
+void CourseRenderer::renderStatic(const FrameSnapshot& p_frame, const char* p_hudText)
+{
+	window->render(0, 0, sprites[SPRITE_BG]);
+	if (p_frame.entities.size() > 0)
+	{
+		for (int i = 0; i < courseCount; i++)
+		{
+			const ViewTransform& view = views[i];
+			window->setView(view.viewport, view.originX, view.originY, view.scale, true);
+			for (int layer : staticLayers)
+			{
+				window->render(p_frame.entities, sprites, layer, 0, p_frame.levelEntityCount);
+			}
+		}
+		window->resetView();
+	}
+	if (p_hudText[0] == '\0')
+	{
+		return;
+	}
+	//hole labels along the bottom of every viewport wide enough for one
+	for (int i = 0; i < courseCount; i++)
+	{
+		const SDL_Rect& v = views[i].viewport;
+		if (v.w < sprites[SPRITE_LEVELTEXT_BG].frame.w)
+		{
+			continue;
+		}
+		char levelText[32];
+		int hole = p_frame.level*p_frame.levelCourseCount + i % p_frame.levelCourseCount + 1;
+		SDL_snprintf(levelText, sizeof(levelText), "HOLE: %d", hole);
+		int centerX = v.x + v.w/2;
+		int bottom = v.y + v.h;
+		window->render(centerX - 132/2, bottom - 32, sprites[SPRITE_LEVELTEXT_BG]);
+		window->renderCenter(centerX - 640/2, bottom - 16 - 480/2 + 3, levelText, font24, black);
+		window->renderCenter(centerX - 640/2, bottom - 16 - 480/2, levelText, font24, white);
+	}
+
+	window->render(640/2 - 196/2, 0, sprites[SPRITE_UI_BG]);
+	window->renderCenter(0, -240 + 16 + 3, p_hudText, font24, black);
+	window->renderCenter(0, -240 + 16, p_hudText, font24, white);
+}
+
+//effects are in course coordinates, centred where the ball's centre was
+void CourseRenderer::addEffect(const SimEvent& p_event)
+{
+	float x = p_event.pos.x + BALL_SIZE/2;
+	float y = p_event.pos.y + BALL_SIZE/2;
+	if (p_event.type == SIM_EVENT_HOLE)
+	{
+		particles.burst(p_event.ball, SPRITE_BALL, x, y, 24, 90, 0.6f, 0.5f);
+	}
+	else if (p_event.type == SIM_EVENT_BOUNCE)
+	{
+		particles.burst(p_event.ball, SPRITE_BALL_SHADOW, x, y, 6, 30, 0.35f, 0.4f);
+	}
+}
+
+void CourseRenderer::updateParticles(const FrameSnapshot& p_frame, float p_seconds)
+{
+	PROFILE_SCOPE("particles");
+	if (p_frame.state == 1 && p_frame.entities.size() > 0)
+	{
+		for (int i = 0; i < courseCount; i++)
+		{
+			int ball = p_frame.levelEntityCount + i*BALL_ENTITY_COUNT;
+			float velX = p_frame.entities.velX[ball];
+			float velY = p_frame.entities.velY[ball];
+			if (velX*velX + velY*velY < TRAIL_MIN_SPEED*TRAIL_MIN_SPEED)
+			{
+				trailTimes[i] = 0;
+				continue;
+			}
+			//the same density at any frame rate
+			for (trailTimes[i] += p_seconds; trailTimes[i] >= TRAIL_INTERVAL; trailTimes[i] -= TRAIL_INTERVAL)
+			{
+				particles.emit(i, SPRITE_BALL, p_frame.entities.posX[ball] + BALL_SIZE/2, p_frame.entities.posY[ball] + BALL_SIZE/2, 0, 0, 0.3f, 0.6f);
+			}
+		}
+	}
+	particles.update(p_seconds);
+}
+
+void CourseRenderer::draw(const FrameSnapshot& p_frame, float p_seconds)
+{
+	SimEvent e;
+	while (effectQueue.pop(e))
+	{
+		addEffect(e);
+	}
+	if (p_frame.levelLoads != drawnLevelLoads)
+	{
+		layoutCourses(p_frame);
+		staticLayerDirty = true;
+		drawnLevelLoads = p_frame.levelLoads;
+		//last level's effects would land in odd places on this one
+		particles.clear();
+	}
+	updateParticles(p_frame, p_seconds);
+	window->clear();
+	const char* hudText = p_frame.hudText;
+	bool staticChanged = staticLayerDirty || SDL_strcmp(hudText, staticLayerText) != 0;
+	if (staticChanged)
+	{
+		SDL_strlcpy(staticLayerText, hudText, sizeof(staticLayerText));
+		staticLayerDirty = false;
+		staticChanges++;
+	}
+	if (staticLayer == NULL)
+	{
+		renderStatic(p_frame, hudText);
+	}
+	else
+	{
+		if (staticChanged)
+		{
+			PROFILE_SCOPE("static layer");
+			window->beginLayer(staticLayer);
+			renderStatic(p_frame, hudText);
+			window->endLayer();
+		}
+		window->renderLayer(staticLayer);
+	}
+	if (particles.size() > 0)
+	{
+		window->render(particles, sprites, views.data());
+	}
+	if (p_frame.entities.size() > 0)
+	{
+		for (int i = 0; i < courseCount; i++)
+		{
+			const ViewTransform& view = views[i];
+			window->setView(view.viewport, view.originX, view.originY, view.scale, true);
+			for (int layer : entityLayers)
+			{
+				window->render(p_frame.entities, sprites, layer, p_frame.levelEntityCount + i*BALL_ENTITY_COUNT, BALL_ENTITY_COUNT);
+			}
+		}
+		for (int i = 0; i < courseCount; i++)
+		{
+			const ViewTransform& view = views[i];
+			window->setView(view.viewport, view.originX, view.originY, view.scale, false);
+			for (int layer : overlayLayers)
+			{
+				window->render(p_frame.entities, sprites, layer, p_frame.levelEntityCount + i*BALL_ENTITY_COUNT, BALL_ENTITY_COUNT);
+			}
+		}
+		window->resetView();
+	}
+	if (p_frame.state == 2)
+	{
+		window->render(0, 0, sprites[SPRITE_ENDSCREEN_OVERLAY]);
+		window->renderCenter(0, 3 - 32, "YOU COMPLETED THE COURSE!", font48, black);
+		window->renderCenter(0, -32, "YOU COMPLETED THE COURSE!", font48, white);
+		window->renderCenter(0, 3 + 32, p_frame.strokeText, font32, black);
+		window->renderCenter(0, 32, p_frame.strokeText, font32, white);
+	}
+}
@@ -0,0 +1,47 @@
+#include "EntityStore.h"
+#include "Math.h"
+
+#include <vector>
+
+void EntityStore::reserve(int p_count)
+{
+	posX.reserve(p_count);
+	posY.reserve(p_count);
+	velX.reserve(p_count);
+	velY.reserve(p_count);
+	scaleX.reserve(p_count);
+	scaleY.reserve(p_count);
+	angle.reserve(p_count);
+	sprite.reserve(p_count);
+	kind.reserve(p_count);
+	flags.reserve(p_count);
+}
+
+void EntityStore::clear()
+{
+	posX.clear();
+	posY.clear();
+	velX.clear();
+	velY.clear();
+	scaleX.clear();
+	scaleY.clear();
+	angle.clear();
+	sprite.clear();
+	kind.clear();
+	flags.clear();
+}
+
+int EntityStore::add(int p_kind, int p_sprite, Vector2f p_pos)
+{
+	posX.push_back(p_pos.x);
+	posY.push_back(p_pos.y);
+	velX.push_back(0);
+	velY.push_back(0);
+	scaleX.push_back(1);
+	scaleY.push_back(1);
+	angle.push_back(0);
+	sprite.push_back(p_sprite);
+	kind.push_back(p_kind);
+	flags.push_back(0);
+	return kind.size() - 1;
+}
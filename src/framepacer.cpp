@@ -0,0 +1,51 @@
+#include <SDL2/SDL.h>
+
+#include "FramePacer.h"
+#include "Profiler.h"
+
+FramePacer::FramePacer()
+	:targetFps(0), frequency(SDL_GetPerformanceFrequency()), period(0), nextFrame(0)
+{
+}
+
+void FramePacer::setTargetFps(double p_fps)
+{
+	targetFps = p_fps > 0 ? p_fps : 0;
+	period = targetFps > 0 ? (Uint64)(frequency/targetFps) : 0;
+	nextFrame = SDL_GetPerformanceCounter() + period;
+}
+
+void FramePacer::wait()
+{
+	if (period == 0)
+	{
+		return;
+	}
+	PROFILE_SCOPE("frame wait");
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (now > nextFrame + period)
+	{
+		nextFrame = now + period;
+		return;
+	}
+	if (now < nextFrame)
+	{
+		double remainingMs = (nextFrame - now)*1000.0/frequency;
+		if (remainingMs > FRAME_SPIN_MS)
+		{
+			SDL_Delay((Uint32)(remainingMs - FRAME_SPIN_MS));
+		}
+		while (SDL_GetPerformanceCounter() < nextFrame)
+		{
+		}
+	}
+	nextFrame += period;
+}
+
+void FramePacer::idle(int p_timeoutMs)
+{
+	PROFILE_SCOPE("idle");
+	//a NULL event leaves whatever arrived in the queue for the next poll
+	SDL_WaitEventTimeout(NULL, p_timeoutMs);
+	nextFrame = SDL_GetPerformanceCounter() + period;
+}
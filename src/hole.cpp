@@ -1,9 +0,0 @@
-#include "Hole.h"
-#include "Entity.h"
-#include "Math.h"
-#include <SDL2/SDL.h>
-
-Hole::Hole(Vector2f p_pos, SDL_Texture* p_tex)
-:Entity(p_pos, p_tex)
-{
-}
\ No newline at end of file
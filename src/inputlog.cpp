@@ -0,0 +1,165 @@
+#include "InputLog.h"
+#include "Simulation.h"
+#include "Session.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+static int16_t clampCoord(float p_value)
+{
+	if (p_value < -32768)
+	{
+		return -32768;
+	}
+	if (p_value > 32767)
+	{
+		return 32767;
+	}
+	return (int16_t)p_value;
+}
+
+static void writeCoord(std::vector<uint8_t>& p_data, int16_t p_value)
+{
+	uint16_t bits = (uint16_t)p_value;
+	p_data.push_back(bits & 0xff);
+	p_data.push_back(bits >> 8);
+}
+
+void InputRecorder::begin(int p_startLevel, int p_courseCount)
+{
+	data.clear();
+	tickCount = 0;
+	lastEntryTick = 0;
+	startLevel = p_startLevel;
+	courseCount = p_courseCount;
+}
+
+//mouse positions come from SDL as whole pixels, so int16 keeps them exact
+void InputRecorder::record(const ShotInput& p_input)
+{
+	bool moved = tickCount == 0 || clampCoord(p_input.mousePos.x) != clampCoord(last.mousePos.x) || clampCoord(p_input.mousePos.y) != clampCoord(last.mousePos.y);
+	if (tickCount == 0 || moved || p_input.mousePressed || p_input.mouseDown != last.mouseDown)
+	{
+		uint32_t run = tickCount - lastEntryTick;
+		while (run >= 0x80)
+		{
+			data.push_back((run & 0x7f) | 0x80);
+			run >>= 7;
+		}
+		data.push_back(run);
+
+		data.push_back((p_input.mouseDown ? INPUT_DOWN : 0) | (p_input.mousePressed ? INPUT_PRESSED : 0) | (moved ? INPUT_MOVED : 0));
+		if (moved)
+		{
+			writeCoord(data, clampCoord(p_input.mousePos.x));
+			writeCoord(data, clampCoord(p_input.mousePos.y));
+		}
+		lastEntryTick = tickCount;
+	}
+	last = p_input;
+	tickCount++;
+}
+
+bool InputRecorder::save(const char* p_filePath, uint64_t p_finalHash) const
+{
+	InputLogHeader header;
+	memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+	header.version = INPUT_LOG_VERSION;
+	header.startLevel = startLevel;
+	header.courseCount = courseCount;
+	header.tickCount = tickCount;
+	header.finalHash = p_finalHash;
+
+	std::ofstream out(p_filePath, std::ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)data.data(), data.size());
+	if (!out)
+	{
+		std::cout << "Failed to write input log " << p_filePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool InputPlayer::load(const char* p_filePath)
+{
+	std::ifstream in(p_filePath, std::ios::binary);
+	if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != INPUT_LOG_VERSION)
+	{
+		std::cout << "Failed to load input log " << p_filePath << std::endl;
+		return false;
+	}
+	//the game always starts recording on the first level, and anything else
+	//would have the session load a level the pack doesn't have
+	if (header.startLevel != 0 || header.courseCount < 1 || header.courseCount > (uint32_t)MAX_COURSES)
+	{
+		std::cout << "Input log " << p_filePath << " was not recorded by the game" << std::endl;
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	rewind();
+	return true;
+}
+
+void InputPlayer::rewind()
+{
+	cursor = 0;
+	tick = 0;
+	current = ShotInput();
+	current.mouseDown = false;
+	current.mousePressed = false;
+	readEntryTick();
+}
+
+void InputPlayer::readEntryTick()
+{
+	uint32_t run = 0;
+	int shift = 0;
+	while (cursor < data.size() && shift < 32)
+	{
+		uint8_t byte = data[cursor++];
+		run |= (uint32_t)(byte & 0x7f) << shift;
+		shift += 7;
+		if (!(byte & 0x80))
+		{
+			nextEntryTick = tick + run;
+			return;
+		}
+	}
+	//no entries left: hold the last input until the tick count runs out
+	nextEntryTick = UINT32_MAX;
+}
+
+//the input of the next tick, false once every recorded tick has been played
+bool InputPlayer::next(ShotInput& p_input)
+{
+	if (tick >= header.tickCount)
+	{
+		return false;
+	}
+	current.mousePressed = false;
+	if (tick == nextEntryTick && cursor < data.size())
+	{
+		uint8_t flags = data[cursor++];
+		current.mouseDown = (flags & INPUT_DOWN) != 0;
+		current.mousePressed = (flags & INPUT_PRESSED) != 0;
+		if ((flags & INPUT_MOVED) && cursor + 4 <= data.size())
+		{
+			current.mousePos.x = (int16_t)(data[cursor] | data[cursor + 1] << 8);
+			current.mousePos.y = (int16_t)(data[cursor + 2] | data[cursor + 3] << 8);
+			cursor += 4;
+		}
+		readEntryTick();
+		tick++;
+	}
+	else
+	{
+		tick++;
+	}
+	p_input = current;
+	return true;
+}
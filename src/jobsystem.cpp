@@ -0,0 +1,218 @@
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+struct WorkerStart
+{
+	JobSystem* system;
+	int queue;
+};
+
+JobSystem::JobSystem()
+	:wake(NULL)
+{
+	SDL_AtomicSet(&pending, 0);
+	SDL_AtomicSet(&quit, 0);
+	queues.push_back(new JobQueue());
+}
+
+JobSystem::~JobSystem()
+{
+	stop();
+	for (JobQueue* q : queues)
+	{
+		delete q;
+	}
+}
+
+//p_workerCount < 0 uses one worker per extra core
+void JobSystem::start(int p_workerCount)
+{
+	stop();
+	if (p_workerCount < 0)
+	{
+		p_workerCount = SDL_GetCPUCount() - 1;
+	}
+	wake = SDL_CreateSemaphore(0);
+	if (wake == NULL)
+	{
+		return;
+	}
+	SDL_AtomicSet(&quit, 0);
+	//workers read this while stealing, so it must never move
+	queues.reserve(p_workerCount + 1);
+	for (int i = 0; i < p_workerCount; i++)
+	{
+		queues.push_back(new JobQueue());
+		WorkerStart* start = new WorkerStart();
+		start->system = this;
+		start->queue = queues.size() - 1;
+		SDL_Thread* thread = SDL_CreateThread(workerMain, "JobSystem", start);
+		if (thread == NULL)
+		{
+			delete start;
+			delete queues.back();
+			queues.pop_back();
+			break;
+		}
+		workers.push_back(thread);
+	}
+}
+
+void JobSystem::stop()
+{
+	SDL_AtomicSet(&quit, 1);
+	for (unsigned int i = 0; i < workers.size(); i++)
+	{
+		SDL_SemPost(wake);
+	}
+	for (SDL_Thread* thread : workers)
+	{
+		SDL_WaitThread(thread, NULL);
+	}
+	workers.clear();
+	while (queues.size() > 1)
+	{
+		delete queues.back();
+		queues.pop_back();
+	}
+	if (wake != NULL)
+	{
+		SDL_DestroySemaphore(wake);
+		wake = NULL;
+	}
+}
+
+int JobSystem::workerMain(void* p_worker)
+{
+	WorkerStart start = *(WorkerStart*)p_worker;
+	delete (WorkerStart*)p_worker;
+	JobSystem* system = start.system;
+
+	while (true)
+	{
+		SDL_SemWait(system->wake);
+		if (SDL_AtomicGet(&system->quit))
+		{
+			break;
+		}
+		//keep going until there's nothing left to take or steal
+		while (system->runOne(start.queue))
+		{
+		}
+	}
+	return 0;
+}
+
+bool JobSystem::push(int p_queue, const Job& p_job)
+{
+	JobQueue* q = queues[p_queue];
+	SDL_AtomicLock(&q->lock);
+	bool pushed = q->bottom - q->top < JOB_QUEUE_SIZE;
+	if (pushed)
+	{
+		q->jobs[q->bottom % JOB_QUEUE_SIZE] = p_job;
+		q->bottom++;
+	}
+	SDL_AtomicUnlock(&q->lock);
+	return pushed;
+}
+
+bool JobSystem::pop(int p_queue, Job& p_job)
+{
+	JobQueue* q = queues[p_queue];
+	SDL_AtomicLock(&q->lock);
+	bool popped = q->bottom > q->top;
+	if (popped)
+	{
+		q->bottom--;
+		p_job = q->jobs[q->bottom % JOB_QUEUE_SIZE];
+	}
+	SDL_AtomicUnlock(&q->lock);
+	return popped;
+}
+
+bool JobSystem::steal(int p_thief, Job& p_job)
+{
+	int count = queues.size();
+	for (int i = 1; i < count; i++)
+	{
+		JobQueue* q = queues[(p_thief + i) % count];
+		SDL_AtomicLock(&q->lock);
+		bool stolen = q->bottom > q->top;
+		if (stolen)
+		{
+			p_job = q->jobs[q->top % JOB_QUEUE_SIZE];
+			q->top++;
+		}
+		SDL_AtomicUnlock(&q->lock);
+		if (stolen)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::runOne(int p_queue)
+{
+	Job job;
+	if (!pop(p_queue, job) && !steal(p_queue, job))
+	{
+		return false;
+	}
+	{
+		PROFILE_SCOPE("job");
+		job.func(job.data, job.begin, job.end);
+	}
+	SDL_AtomicAdd(&pending, -1);
+	return true;
+}
+
+//Splits [0, p_count) into chunks of p_grain, deals them out to every queue
+//and helps run them. Returns once all of them are done.
+void JobSystem::parallelFor(int p_count, int p_grain, JobFunc p_func, void* p_data)
+{
+	if (p_grain < 1)
+	{
+		p_grain = 1;
+	}
+	if (workers.empty() || p_count <= p_grain)
+	{
+		p_func(p_data, 0, p_count);
+		return;
+	}
+
+	int queueCount = queues.size();
+	int chunks = 0;
+	for (int begin = 0; begin < p_count; begin += p_grain, chunks++)
+	{
+		Job job;
+		job.func = p_func;
+		job.data = p_data;
+		job.begin = begin;
+		job.end = SDL_min(begin + p_grain, p_count);
+		SDL_AtomicAdd(&pending, 1);
+		if (!push(chunks % queueCount, job))
+		{
+			//queue full: do it now rather than grow anything
+			SDL_AtomicAdd(&pending, -1);
+			p_func(p_data, job.begin, job.end);
+		}
+	}
+	for (unsigned int i = 0; i < workers.size() && (int)i < chunks; i++)
+	{
+		SDL_SemPost(wake);
+	}
+
+	while (runOne(0))
+	{
+	}
+	//the last jobs may still be running on workers
+	while (SDL_AtomicGet(&pending) > 0)
+	{
+		runOne(0);
+	}
+}
@@ -0,0 +1,15 @@
+#include "Level.h"
+
+int getTileWidth(int p_type)
+{
+	if (p_type == TILE_DARK_64 || p_type == TILE_LIGHT_64)
+	{
+		return 64;
+	}
+	return 32;
+}
+
+int getTileHeight(int p_type)
+{
+	return getTileWidth(p_type) + 3;
+}
@@ -0,0 +1,213 @@
+#include "LevelPack.h"
+#include "CollisionWorld.h"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+LevelPack::LevelPack()
+:data(NULL), size(0)
+{
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+LevelPack::~LevelPack()
+{
+	close();
+}
+
+bool LevelPack::open(const char* p_filePath)
+{
+	close();
+#ifdef _WIN32
+	file = CreateFileA(p_filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER fileSize;
+	if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL)
+		{
+			data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			size = data != NULL ? (size_t)fileSize.QuadPart : 0;
+		}
+	}
+#else
+	int fd = ::open(p_filePath, O_RDONLY);
+	struct stat info;
+	if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0)
+	{
+		void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED)
+		{
+			data = (const unsigned char*)mapped;
+			size = info.st_size;
+		}
+	}
+	if (fd >= 0)
+	{
+		::close(fd);
+	}
+#endif
+
+	if (data == NULL)
+	{
+		std::cout << "Failed to open level pack: " << p_filePath << std::endl;
+		close();
+		return false;
+	}
+	if (!validate())
+	{
+		std::cout << "Level pack is corrupt or from another version: " << p_filePath << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void LevelPack::close()
+{
+#ifdef _WIN32
+	if (data != NULL)
+		UnmapViewOfFile(data);
+	if (mapping != NULL)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data != NULL)
+		munmap((void*)data, size);
+#endif
+	data = NULL;
+	size = 0;
+}
+
+//the grid is read in place by CollisionWorld, so every cell's range and every
+//tile index in it has to be inside its array
+static bool validateGrid(const PackLevel& p_level, const int32_t* p_cellStart, const int32_t* p_cellTiles)
+{
+	if (p_level.tileCount > 0 && (p_level.gridCols == 0 || p_level.gridRows == 0))
+	{
+		return false;
+	}
+	int64_t cellCount = (int64_t)p_level.gridCols*p_level.gridRows;
+	if (p_cellStart[0] != 0 || (uint32_t)p_cellStart[cellCount] > p_level.cellTileCount)
+	{
+		return false;
+	}
+	for (int64_t i = 0; i < cellCount; i++)
+	{
+		if (p_cellStart[i + 1] < p_cellStart[i])
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < p_level.cellTileCount; i++)
+	{
+		if (p_cellTiles[i] < 0 || (uint32_t)p_cellTiles[i] >= p_level.tileCount)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//The header, the level table and every level's grid are checked, so nothing
+//read from the mapped file later can point outside it.
+bool LevelPack::validate() const
+{
+	if (size < sizeof(PackHeader))
+	{
+		return false;
+	}
+	const PackHeader* header = (const PackHeader*)data;
+	if (std::memcmp(header->magic, LEVEL_PACK_MAGIC, 4) != 0 || header->version != LEVEL_PACK_VERSION)
+	{
+		return false;
+	}
+	if (header->levelsOffset % 4 != 0 || header->levelsOffset > size || (size - header->levelsOffset)/sizeof(PackLevel) < header->levelCount)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < getLevelCount(); i++)
+	{
+		const PackLevel& l = getLevel(i);
+		const uint32_t offsets[6] = {l.coursesOffset, l.tilesOffset, l.boxesOffset, l.boxCellsOffset, l.cellStartOffset, l.cellTilesOffset};
+		const uint64_t lengths[6] = {
+			(uint64_t)l.courseCount*sizeof(PackCourse),
+			(uint64_t)l.tileCount*sizeof(PackTile),
+			(uint64_t)l.tileCount*sizeof(SimRect),
+			(uint64_t)l.tileCount*2*sizeof(int32_t),
+			((uint64_t)l.gridCols*l.gridRows + 1)*sizeof(int32_t),
+			(uint64_t)l.cellTileCount*sizeof(int32_t)};
+		if (l.gridCols < 0 || l.gridRows < 0)
+		{
+			return false;
+		}
+		for (int j = 0; j < 6; j++)
+		{
+			if (offsets[j] % 4 != 0 || offsets[j] > size || lengths[j] > size - offsets[j])
+			{
+				return false;
+			}
+		}
+		if (!validateGrid(l, (const int32_t*)(data + l.cellStartOffset), (const int32_t*)(data + l.cellTilesOffset)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int LevelPack::getLevelCount() const
+{
+	if (data == NULL)
+	{
+		return 0;
+	}
+	return ((const PackHeader*)data)->levelCount;
+}
+
+const PackLevel& LevelPack::getLevel(int p_level) const
+{
+	const PackHeader* header = (const PackHeader*)data;
+	return ((const PackLevel*)(data + header->levelsOffset))[p_level];
+}
+
+const PackCourse* LevelPack::getCourses(const PackLevel& p_level) const
+{
+	return (const PackCourse*)(data + p_level.coursesOffset);
+}
+
+const PackTile* LevelPack::getTiles(const PackLevel& p_level) const
+{
+	return (const PackTile*)(data + p_level.tilesOffset);
+}
+
+CollisionGrid LevelPack::getGrid(const PackLevel& p_level) const
+{
+	CollisionGrid grid;
+	grid.originX = p_level.gridOriginX;
+	grid.originY = p_level.gridOriginY;
+	grid.cols = p_level.gridCols;
+	grid.rows = p_level.gridRows;
+	grid.boxCount = p_level.tileCount;
+	grid.boxes = (const SimRect*)(data + p_level.boxesOffset);
+	grid.boxCells = (const int*)(data + p_level.boxCellsOffset);
+	grid.cellStart = (const int*)(data + p_level.cellStartOffset);
+	grid.cellTiles = (const int*)(data + p_level.cellTilesOffset);
+	return grid;
+}
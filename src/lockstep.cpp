@@ -0,0 +1,510 @@
+#include "Lockstep.h"
+#include "Session.h"
+#include "Simulation.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+//packets are little endian whatever the machine is
+static void writeU32(uint8_t* p_data, uint32_t p_value)
+{
+	p_data[0] = p_value;
+	p_data[1] = p_value >> 8;
+	p_data[2] = p_value >> 16;
+	p_data[3] = p_value >> 24;
+}
+
+static uint32_t readU32(const uint8_t* p_data)
+{
+	return p_data[0] | p_data[1] << 8 | p_data[2] << 16 | (uint32_t)p_data[3] << 24;
+}
+
+static void writeU64(uint8_t* p_data, uint64_t p_value)
+{
+	writeU32(p_data, (uint32_t)p_value);
+	writeU32(p_data + 4, (uint32_t)(p_value >> 32));
+}
+
+static uint64_t readU64(const uint8_t* p_data)
+{
+	return readU32(p_data) | (uint64_t)readU32(p_data + 4) << 32;
+}
+
+static float clampDrag(float p_drag)
+{
+	return p_drag < -32767 ? -32767 : p_drag > 32767 ? 32767 : p_drag;
+}
+
+//magic, type, flags, shot count, pad, tick, advantage, known, ack, hash tick, hash
+const int INPUT_HEADER_SIZE = 36;
+const int SHOT_SIZE = 8;
+//magic, type, ball count, finished, pad, tick, level
+const int SNAPSHOT_HEADER_SIZE = 16;
+
+Lockstep::Lockstep(Session& p_session, int p_player, int p_inputDelay)
+	:session(p_session), player(p_player), inputDelay(p_inputDelay)
+{
+	states.resize(MAX_ROLLBACK_TICKS);
+	for (TickState& s : states)
+	{
+		s.state.balls.reserve(VERSUS_PLAYERS);
+	}
+	snapshot.balls.reserve(VERSUS_PLAYERS);
+	for (std::vector<NetShot>& s : shots)
+	{
+		s.reserve(256);
+	}
+	reset();
+}
+
+void Lockstep::reset()
+{
+	simTick = 0;
+	for (std::vector<NetShot>& s : shots)
+	{
+		s.clear();
+	}
+	localKnown = inputDelay - 1;
+	remoteKnown = -1;
+	remoteAck = -1;
+	localAdvantage = 0;
+	remoteAdvantage = 0;
+	lastWaitTick = 0;
+	rollbacks = 0;
+	nextHashTick = HASH_INTERVAL;
+	for (int i = 0; i < HASH_HISTORY; i++)
+	{
+		hashTicks[i] = -1;
+	}
+	remoteHashTick = -1;
+	firstValidHashTick = 0;
+	desynced = false;
+	snapshotRequested = false;
+	lastSnapshotTick = -HASH_INTERVAL;
+	resyncs = 0;
+}
+
+bool Lockstep::shoot(Vector2f p_drag)
+{
+	int tick = simTick + inputDelay;
+	std::vector<NetShot>& local = shots[player];
+	if (!local.empty() && tick < local.back().tick + INPUT_SHOT_TICKS)
+	{
+		return false;
+	}
+	NetShot shot;
+	shot.tick = tick;
+	shot.dragX = (int16_t)clampDrag(p_drag.x);
+	shot.dragY = (int16_t)clampDrag(p_drag.y);
+	local.push_back(shot);
+	//no other shot can be scheduled before this one now
+	localKnown = tick;
+	return true;
+}
+
+bool Lockstep::canAdvance() const
+{
+	return simTick - remoteKnown < MAX_ROLLBACK_TICKS;
+}
+
+void Lockstep::advance()
+{
+	simulate();
+	if (simTick + inputDelay - 1 > localKnown)
+	{
+		localKnown = simTick + inputDelay - 1;
+	}
+	updateHashes();
+}
+
+int Lockstep::getFrameAdvantage() const
+{
+	return (localAdvantage - remoteAdvantage)/2;
+}
+
+bool Lockstep::shouldWait()
+{
+	if (!connected || getFrameAdvantage() <= 1 || simTick - lastWaitTick < TIME_SYNC_TICKS)
+	{
+		return false;
+	}
+	lastWaitTick = simTick;
+	return true;
+}
+
+//every tick before this one had both players' shots known when it ran
+int Lockstep::getConfirmedTick() const
+{
+	return remoteKnown + 1 < simTick ? remoteKnown + 1 : simTick;
+}
+
+//a shot is a press, a tick of dragging and a release; the ball only sees the
+//drag relative to the press, so positions are in drag space
+void Lockstep::getInput(const std::vector<NetShot>& p_shots, int p_tick, ShotInput& p_input) const
+{
+	p_input.mouseDown = false;
+	p_input.mousePressed = false;
+	p_input.mousePos = Vector2f(0, 0);
+	for (int i = (int)p_shots.size() - 1; i >= 0; i--)
+	{
+		const NetShot& shot = p_shots[i];
+		if (shot.tick > p_tick)
+		{
+			continue;
+		}
+		int offset = p_tick - shot.tick;
+		if (offset >= INPUT_SHOT_TICKS)
+		{
+			return;
+		}
+		p_input.mouseDown = offset < 2;
+		p_input.mousePressed = offset == 0;
+		if (offset > 0)
+		{
+			p_input.mousePos = Vector2f(shot.dragX, shot.dragY);
+		}
+		return;
+	}
+}
+
+void Lockstep::simulate()
+{
+	TickState& s = states[simTick % MAX_ROLLBACK_TICKS];
+	session.save(s.state);
+	s.hash = session.hash();
+
+	unsigned int firstEvent = session.events.size();
+	for (int p = 0; p < VERSUS_PLAYERS; p++)
+	{
+		ShotInput input;
+		getInput(shots[p], simTick, input);
+		session.stepCourse(p, input);
+	}
+	session.endStep();
+	if (resimulating)
+	{
+		//the local ball's events were already played the first time round
+		unsigned int kept = firstEvent;
+		for (unsigned int i = firstEvent; i < session.events.size(); i++)
+		{
+			if (session.events[i].ball != player)
+			{
+				session.events[kept++] = session.events[i];
+			}
+		}
+		session.events.resize(kept);
+	}
+	simTick++;
+}
+
+void Lockstep::rollback(int p_tick)
+{
+	session.restore(states[p_tick % MAX_ROLLBACK_TICKS].state);
+	resimulate(p_tick);
+	rollbacks++;
+}
+
+//the session holds the state before p_fromTick, run it back up to simTick
+void Lockstep::resimulate(int p_fromTick)
+{
+	int end = simTick;
+	simTick = p_fromTick;
+	resimulating = true;
+	while (simTick < end)
+	{
+		simulate();
+	}
+	resimulating = false;
+}
+
+//the hash of the state before p_tick, which is still in the window
+uint64_t Lockstep::getHash(int p_tick) const
+{
+	return p_tick == simTick ? session.hash() : states[p_tick % MAX_ROLLBACK_TICKS].hash;
+}
+
+void Lockstep::updateHashes()
+{
+	while (nextHashTick <= getConfirmedTick())
+	{
+		int slot = (nextHashTick/HASH_INTERVAL) % HASH_HISTORY;
+		hashTicks[slot] = nextHashTick;
+		hashes[slot] = getHash(nextHashTick);
+		if (remoteHashTick == nextHashTick)
+		{
+			checkHash(remoteHashTick, remoteHash);
+		}
+		nextHashTick += HASH_INTERVAL;
+	}
+}
+
+void Lockstep::checkHash(int p_tick, uint64_t p_hash)
+{
+	int slot = (p_tick/HASH_INTERVAL) % HASH_HISTORY;
+	if (p_tick < firstValidHashTick || hashTicks[slot] != p_tick)
+	{
+		return;
+	}
+	bool match = hashes[slot] == p_hash;
+	if (!match && !desynced)
+	{
+		std::cout << "Desync at tick " << p_tick << std::endl;
+	}
+	desynced = !match;
+}
+
+int Lockstep::writePacket(uint8_t* p_data, int p_size)
+{
+	if (snapshotRequested && player == 0 && simTick - lastSnapshotTick >= HASH_INTERVAL)
+	{
+		snapshotRequested = false;
+		lastSnapshotTick = simTick;
+		return writeSnapshot(p_data, p_size, getConfirmedTick());
+	}
+	if (p_size < INPUT_HEADER_SIZE + MAX_PACKET_SHOTS*SHOT_SIZE)
+	{
+		return 0;
+	}
+
+	//every shot the peer hasn't acknowledged, resent until it has
+	const std::vector<NetShot>& local = shots[player];
+	int first = local.size();
+	while (first > 0 && local[first - 1].tick > remoteAck)
+	{
+		first--;
+	}
+	int count = local.size() - first;
+	int known = localKnown;
+	if (count > MAX_PACKET_SHOTS)
+	{
+		count = MAX_PACKET_SHOTS;
+		known = local[first + count].tick - 1;
+	}
+	int hashTick = nextHashTick - HASH_INTERVAL;
+	int slot = (hashTick/HASH_INTERVAL) % HASH_HISTORY;
+	bool hasHash = hashTick > 0 && hashTicks[slot] == hashTick;
+
+	writeU32(p_data, NET_MAGIC);
+	p_data[4] = PACKET_INPUT;
+	p_data[5] = desynced && player != 0 ? PACKET_RESYNC : 0;
+	p_data[6] = count;
+	p_data[7] = 0;
+	writeU32(p_data + 8, simTick);
+	writeU32(p_data + 12, localAdvantage);
+	writeU32(p_data + 16, known);
+	writeU32(p_data + 20, remoteKnown);
+	writeU32(p_data + 24, hasHash ? hashTick : -1);
+	writeU64(p_data + 28, hasHash ? hashes[slot] : 0);
+	uint8_t* out = p_data + INPUT_HEADER_SIZE;
+	for (int i = 0; i < count; i++)
+	{
+		const NetShot& shot = local[first + i];
+		writeU32(out, shot.tick);
+		out[4] = (uint16_t)shot.dragX;
+		out[5] = (uint16_t)shot.dragX >> 8;
+		out[6] = (uint16_t)shot.dragY;
+		out[7] = (uint16_t)shot.dragY >> 8;
+		out += SHOT_SIZE;
+	}
+	return out - p_data;
+}
+
+void Lockstep::readPacket(const uint8_t* p_data, int p_size)
+{
+	if (p_size < 5 || readU32(p_data) != NET_MAGIC)
+	{
+		return;
+	}
+	if (p_data[4] == PACKET_SNAPSHOT)
+	{
+		readSnapshot(p_data, p_size);
+		return;
+	}
+	int count = p_size >= INPUT_HEADER_SIZE ? p_data[6] : 0;
+	if (p_data[4] != PACKET_INPUT || count > MAX_PACKET_SHOTS || p_size < INPUT_HEADER_SIZE + count*SHOT_SIZE)
+	{
+		return;
+	}
+	connected = true;
+	if (p_data[5] & PACKET_RESYNC)
+	{
+		snapshotRequested = true;
+	}
+	int tick = (int32_t)readU32(p_data + 8);
+	localAdvantage = simTick - tick;
+	remoteAdvantage = (int32_t)readU32(p_data + 12);
+	int known = (int32_t)readU32(p_data + 16);
+	int ack = (int32_t)readU32(p_data + 20);
+	if (ack > remoteAck)
+	{
+		remoteAck = ack;
+	}
+
+	//packets can come out of order, so only shots past what is known are new
+	std::vector<NetShot>& remote = shots[1 - player];
+	int firstNewTick = -1;
+	const uint8_t* in = p_data + INPUT_HEADER_SIZE;
+	for (int i = 0; i < count; i++)
+	{
+		NetShot shot;
+		shot.tick = (int32_t)readU32(in);
+		shot.dragX = (int16_t)(in[4] | in[5] << 8);
+		shot.dragY = (int16_t)(in[6] | in[7] << 8);
+		in += SHOT_SIZE;
+		if (shot.tick <= remoteKnown || shot.tick > known)
+		{
+			continue;
+		}
+		remote.push_back(shot);
+		if (firstNewTick < 0)
+		{
+			firstNewTick = shot.tick;
+		}
+	}
+	if (known > remoteKnown)
+	{
+		remoteKnown = known;
+	}
+	//the peer was predicted not to shoot, so anything already simulated past
+	//its shot is wrong
+	if (firstNewTick >= 0 && firstNewTick < simTick)
+	{
+		rollback(firstNewTick);
+	}
+
+	int hashTick = (int32_t)readU32(p_data + 24);
+	if (hashTick > remoteHashTick)
+	{
+		remoteHashTick = hashTick;
+		remoteHash = readU64(p_data + 28);
+		checkHash(remoteHashTick, remoteHash);
+	}
+	updateHashes();
+}
+
+//each ball is sent as a mask of the words that differ from its spawn state,
+//then those words XORed with the spawn's, so a ball sitting where it started
+//costs four bytes
+int Lockstep::writeSnapshot(uint8_t* p_data, int p_size, int p_tick)
+{
+	if (p_tick == simTick)
+	{
+		session.save(snapshot);
+	}
+	else
+	{
+		snapshot = states[p_tick % MAX_ROLLBACK_TICKS].state;
+	}
+	int ballCount = snapshot.balls.size();
+	if (p_size < SNAPSHOT_HEADER_SIZE + ballCount*(BALL_STATE_WORDS + 1)*4)
+	{
+		return 0;
+	}
+	writeU32(p_data, NET_MAGIC);
+	p_data[4] = PACKET_SNAPSHOT;
+	p_data[5] = ballCount;
+	p_data[6] = snapshot.finished;
+	p_data[7] = 0;
+	writeU32(p_data + 8, p_tick);
+	writeU32(p_data + 12, snapshot.level);
+	uint8_t* out = p_data + SNAPSHOT_HEADER_SIZE;
+	for (int i = 0; i < ballCount; i++)
+	{
+		BallState spawn;
+		session.getSpawnState(snapshot.level, i, spawn);
+		uint32_t words[BALL_STATE_WORDS];
+		uint32_t spawnWords[BALL_STATE_WORDS];
+		packBallState(snapshot.balls[i], words);
+		packBallState(spawn, spawnWords);
+		uint8_t* maskOut = out;
+		out += 4;
+		uint32_t mask = 0;
+		for (int w = 0; w < BALL_STATE_WORDS; w++)
+		{
+			uint32_t delta = words[w] ^ spawnWords[w];
+			if (delta != 0)
+			{
+				mask |= 1u << w;
+				writeU32(out, delta);
+				out += 4;
+			}
+		}
+		writeU32(maskOut, mask);
+	}
+	//the host's own comparisons against the peer's stale hashes don't count
+	firstValidHashTick = p_tick;
+	desynced = false;
+	return out - p_data;
+}
+
+void Lockstep::readSnapshot(const uint8_t* p_data, int p_size)
+{
+	if (player == 0 || !desynced || p_size < SNAPSHOT_HEADER_SIZE)
+	{
+		return;
+	}
+	int ballCount = p_data[5];
+	int tick = (int32_t)readU32(p_data + 8);
+	//too old to run forward from, or ahead of us; another one will come
+	if (ballCount != session.getCourseCount() || tick > simTick || simTick - tick >= MAX_ROLLBACK_TICKS)
+	{
+		return;
+	}
+	//one past the last level is a finished session and nothing else is, any
+	//other level or pairing is garbage that would read past the level table
+	int level = (int32_t)readU32(p_data + 12);
+	bool finished = p_data[6] != 0;
+	if (level < 0 || level > session.pack->getLevelCount() || finished != (level == session.pack->getLevelCount()))
+	{
+		return;
+	}
+	snapshot.finished = finished;
+	snapshot.level = level;
+	snapshot.balls.resize(ballCount);
+	const uint8_t* in = p_data + SNAPSHOT_HEADER_SIZE;
+	const uint8_t* end = p_data + p_size;
+	for (int i = 0; i < ballCount; i++)
+	{
+		if (in + 4 > end)
+		{
+			return;
+		}
+		uint32_t mask = readU32(in);
+		in += 4;
+		BallState spawn;
+		session.getSpawnState(snapshot.level, i, spawn);
+		uint32_t words[BALL_STATE_WORDS];
+		packBallState(spawn, words);
+		for (int w = 0; w < BALL_STATE_WORDS; w++)
+		{
+			if (mask & (1u << w))
+			{
+				if (in + 4 > end)
+				{
+					return;
+				}
+				words[w] ^= readU32(in);
+				in += 4;
+			}
+		}
+		unpackBallState(words, snapshot.balls[i]);
+		//the index picks the course events and effects belong to, so it isn't the peer's to set
+		snapshot.balls[i].index = i;
+	}
+
+	session.restore(snapshot);
+	resimulate(tick);
+	desynced = false;
+	resyncs++;
+	//hashes from before the resync are recomputed from the host's state
+	firstValidHashTick = tick;
+	nextHashTick = (tick + HASH_INTERVAL - 1)/HASH_INTERVAL*HASH_INTERVAL;
+	if (nextHashTick == 0)
+	{
+		nextHashTick = HASH_INTERVAL;
+	}
+	updateHashes();
+	std::cout << "Resynced to the host at tick " << tick << std::endl;
+}
@@ -2,14 +2,31 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_mixer.h>
+#include <atomic>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include "RenderWindow.h"
-#include "Entity.h"
+#include "AssetLoader.h"
+#include "Sound.h"
+#include "EntityStore.h"
 #include "Ball.h"	
-#include "Tile.h"
-#include "Hole.h"
+#include "Level.h"
+#include "LevelPack.h"
+#include "Simulation.h"
+#include "CollisionWorld.h"
+#include "Profiler.h"
+#include "Session.h"
+#include "InputLog.h"
+#include "JobSystem.h"
+#include "FramePacer.h"
+#include "AllocCounter.h"
+#include "Net.h"
+#include "Lockstep.h"
+#include "StateHistory.h"
+#include "TripleBuffer.h"
+#include "CourseRenderer.h"
 
 bool init()
 {
@@ -27,28 +44,80 @@ bool SDLinit = init();
 
 RenderWindow window("Twini-Golf", 640, 480);
 
-SDL_Texture* ballTexture = window.loadTexture("res/gfx/ball.png");
-SDL_Texture* holeTexture = window.loadTexture("res/gfx/hole.png");
-SDL_Texture* pointTexture = window.loadTexture("res/gfx/point.png");
-SDL_Texture* tileDarkTexture32 = window.loadTexture("res/gfx/tile32_dark.png");
-SDL_Texture* tileDarkTexture64 = window.loadTexture("res/gfx/tile64_dark.png");
-SDL_Texture* tileLightTexture32 = window.loadTexture("res/gfx/tile32_light.png");
-SDL_Texture* tileLightTexture64 = window.loadTexture("res/gfx/tile64_light.png");
-SDL_Texture* ballShadowTexture = window.loadTexture("res/gfx/ball_shadow.png");
-SDL_Texture* bgTexture = window.loadTexture("res/gfx/bg.png");
-SDL_Texture* uiBgTexture = window.loadTexture("res/gfx/UI_bg.png");
-SDL_Texture* levelTextBgTexture = window.loadTexture("res/gfx/levelText_bg.png");
-SDL_Texture* powerMeterTexture_FG = window.loadTexture("res/gfx/powermeter_fg.png");
-SDL_Texture* powerMeterTexture_BG = window.loadTexture("res/gfx/powermeter_bg.png");
-SDL_Texture* powerMeterTexture_overlay = window.loadTexture("res/gfx/powermeter_overlay.png");
-SDL_Texture* logoTexture = window.loadTexture("res/gfx/logo.png");
-SDL_Texture* click2start = window.loadTexture("res/gfx/click2start.png");
-SDL_Texture* endscreenOverlayTexture = window.loadTexture("res/gfx/end.png");
-SDL_Texture* splashBgTexture = window.loadTexture("res/gfx/splashbg.png");
-
-Mix_Chunk* chargeSfx = Mix_LoadWAV("res/sfx/charge.mp3");
-Mix_Chunk* swingSfx = Mix_LoadWAV("res/sfx/swing.mp3");
-Mix_Chunk* holeSfx = Mix_LoadWAV("res/sfx/hole.mp3");
+Sprite sprites[SPRITE_COUNT];
+
+const char* soundPaths[SOUND_COUNT] = {
+	"res/sfx/charge.mp3",
+	"res/sfx/swing.mp3",
+	"res/sfx/hole.mp3",
+};
+
+Mix_Chunk* sounds[SOUND_COUNT] = {NULL, NULL, NULL};
+//a hole-out is never cut off by swings, and however many courses swing at
+//once only a few are heard
+const SoundSettings soundSettings[SOUND_COUNT] = {
+	{0, 2, MIX_MAX_VOLUME},
+	{1, 3, MIX_MAX_VOLUME},
+	{2, 2, MIX_MAX_VOLUME},
+};
+SoundQueue soundQueue;
+VoiceManager voices;
+
+AssetLoader assets;
+int spriteAssets[SPRITE_COUNT];
+int soundAssets[SOUND_COUNT];
+bool assetsLoaded = false;
+
+//decoding runs on worker threads while the splash screen is up
+bool startLoading()
+{
+	for (int i = 0; i < SPRITE_COUNT; i++)
+	{
+		spriteAssets[i] = assets.queueImage(spritePaths[i]);
+	}
+	for (int i = 0; i < SOUND_COUNT; i++)
+	{
+		soundAssets[i] = assets.queueSound(soundPaths[i]);
+	}
+
+	//decoded sounds are kept as raw PCM here so later launches skip the MP3 decoder
+	char* prefPath = SDL_GetPrefPath("PolyMars", "Twini-Golf");
+	assets.setSoundCacheDir(prefPath);
+	SDL_free(prefPath);
+
+	assets.start();
+	return true;
+}
+
+bool loadingStarted = startLoading();
+
+//called every frame on the render thread, uploads everything once decoded
+void finishLoading()
+{
+	if (assetsLoaded || !assets.isDone())
+	{
+		return;
+	}
+	assets.wait();
+
+	SDL_Surface* surfaces[SPRITE_COUNT];
+	for (int i = 0; i < SPRITE_COUNT; i++)
+	{
+		surfaces[i] = assets.takeSurface(spriteAssets[i]);
+	}
+	window.buildAtlas(spritePaths, surfaces, SPRITE_COUNT);
+	for (int i = 0; i < SPRITE_COUNT; i++)
+	{
+		SDL_FreeSurface(surfaces[i]);
+		sprites[i] = window.getSprite(spritePaths[i]);
+	}
+
+	for (int i = 0; i < SOUND_COUNT; i++)
+	{
+		sounds[i] = assets.takeChunk(soundAssets[i]);
+	}
+	assetsLoaded = true;
+}
 
 
 SDL_Color white = { 255, 255, 255 };
@@ -57,79 +126,107 @@ TTF_Font* font32 = TTF_OpenFont("res/font/font.ttf", 32);
 TTF_Font* font48 = TTF_OpenFont("res/font/font.ttf", 48);
 TTF_Font* font24 = TTF_OpenFont("res/font/font.ttf", 24);
 
-Ball balls[2] = {Ball(Vector2f(0, 0), ballTexture, pointTexture, powerMeterTexture_FG, powerMeterTexture_BG, 0), Ball(Vector2f(0, 0), ballTexture, pointTexture, powerMeterTexture_FG, powerMeterTexture_BG, 1)};
-std::vector<Hole> holes = {Hole(Vector2f(0, 0), holeTexture), Hole(Vector2f(0, 0), holeTexture)};
-
-std::vector<Tile> loadTiles(int level)
-{
-	std::vector<Tile> temp = {};
-	switch(level) 
-	{
-		case 0:
-			temp.push_back(Tile(Vector2f(64*3, 64*3), tileDarkTexture64));
-			temp.push_back(Tile(Vector2f(64*4, 64*3), tileDarkTexture64));
-
-			temp.push_back(Tile(Vector2f(64*0, 64*3), tileDarkTexture64));
-			temp.push_back(Tile(Vector2f(64*1, 64*3), tileDarkTexture64));
-
-			temp.push_back(Tile(Vector2f(64*3 + 64*5, 64*3), tileLightTexture64));
-			temp.push_back(Tile(Vector2f(64*4 + 64*5, 64*3), tileLightTexture64));
-
-			temp.push_back(Tile(Vector2f(64*0 + 64*5, 64*3), tileLightTexture64));
-			temp.push_back(Tile(Vector2f(64*1 + 64*5, 64*3), tileLightTexture64));
-		break;
-		case 1:
-			temp.push_back(Tile(Vector2f(64*2, 64*3), tileDarkTexture64));
-
-			temp.push_back(Tile(Vector2f(64*4 + 64*5, 64*3), tileLightTexture64));
-		break;
-		case 2:
-			temp.push_back(Tile(Vector2f(32*1 + 32*10 + 16, 32*5), tileLightTexture32));
-		break;
-		case 3:
-			temp.push_back(Tile(Vector2f(32*4, 32*7), tileDarkTexture64));
-			temp.push_back(Tile(Vector2f(32*3, 32*5), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*6, 32*3), tileDarkTexture32));
-
-			temp.push_back(Tile(Vector2f(32*4 + 64*5, 32*2), tileLightTexture64));
-			temp.push_back(Tile(Vector2f(32*3 + 32*10, 32*6), tileLightTexture32));
-			temp.push_back(Tile(Vector2f(32*6 + 32*10, 32*9), tileLightTexture32));
-		break;
-		case 4:
-			temp.push_back(Tile(Vector2f(32*3, 32*1), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*1, 32*3), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*5, 32*3), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*3, 32*5), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*7, 32*5), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*7, 32*10), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*3, 32*10), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*5, 32*12), tileDarkTexture32));
-			temp.push_back(Tile(Vector2f(32*7, 32*10), tileDarkTexture32));
-
-			//temp.push_back(Tile(Vector2f(32*4, 32*7), tileDarkTexture64));
-			temp.push_back(Tile(Vector2f(32*8, 32*7), tileDarkTexture64));
-
-			temp.push_back(Tile(Vector2f(32*2 + 32*10, 32*2), tileLightTexture32));
-			temp.push_back(Tile(Vector2f(32*5 + 32*10, 32*11), tileLightTexture32));
-
-			temp.push_back(Tile(Vector2f(32*3 + 32*10, 32*1), tileLightTexture64));
-			temp.push_back(Tile(Vector2f(32*8 + 32*10, 32*6), tileLightTexture64));
-			temp.push_back(Tile(Vector2f(32*3 + 32*10, 32*11), tileLightTexture64));
-		break;
-	}
-	return temp;
-}
-
-int level = 0;
-std::vector<Tile> tiles = loadTiles(level);
+EntityStore entities;
+
+LevelPack levelPack;
+bool levelPackLoaded = levelPack.open("res/levels/course.pack");
+//--courses <n> plays n courses at once, laid out in a grid of viewports
+int courseCount = 2;
+Session session(&levelPack);
+
+//the holes and tiles come first in entities, then BALL_ENTITY_COUNT per course
+int levelEntityCount = 0;
+
+//--threads <n> sets the worker count, by default one per extra core
+JobSystem jobs;
+int threadCount = -1;
+//fewer courses than this are not worth waking the workers for
+const int PARALLEL_COURSE_COUNT = 8;
+const int COURSES_PER_JOB = 4;
+
+//--record <file> logs every tick's input, for tools/replay.cpp
+InputRecorder inputRecorder;
+const char* recordFilePath = NULL;
+
+//--host <port> or --join <host> <port> plays versus over the network, one
+//course each; --input-delay <ticks> trades responsiveness for fewer
+//rollbacks, --loss <percent> and --latency <ms> simulate a bad connection
+UdpSocket netSocket;
+Lockstep* lockstep = NULL;
+int hostPort = 0;
+const char* joinHost = NULL;
+int joinPort = 0;
+int inputDelay = 8;
+float netLoss = 0;
+int netLatency = 0;
+uint8_t netPacket[MAX_PACKET_SIZE];
+//Ctrl+Z or Backspace undoes the last stroke and holding Left or Right scrubs
+//through recent play, which stays paused until the next click; off in versus
+//and while recording, where play only goes forward
+StateHistory history;
+bool historyEnabled = false;
+bool scrubbing = false;
+int scrubDirection = 0;
+
+//the local player's drag starts where they pressed, like a local shot does
+bool localAiming = false;
+Vector2f aimStart;
 
 bool gameRunning = true;
 bool mouseDown = false;
 bool mousePressed = false;
+Vector2f mousePos;
 
 bool swingPlayed = false;
 bool secondSwingPlayed = false;
 
+//Play runs on two threads. This one polls input and draws; the simulation
+//thread steps the session and publishes a snapshot of everything drawn after
+//every update, so a slow present or text upload can't hold up the physics.
+//--single-thread runs both back to back here, as happens anyway where
+//threads aren't available.
+TripleBuffer<FrameSnapshot> frames;
+bool singleThread = false;
+SDL_Thread* simThread = NULL;
+std::atomic<bool> simRunning(false);
+//posted after every batch of input, so a sleeping simulation wakes for it
+SDL_sem* inputReady = NULL;
+//counts loadEntities() calls, for FrameSnapshot::levelLoads
+int levelLoads = 0;
+int publishedIdleMs = 0;
+//input as last polled, for update(); presses and undos are counted so none
+//are lost between updates, the mouse position is packed so x and y stay paired
+std::atomic<bool> polledMouseDown(false);
+std::atomic<int> polledMousePos(0);
+std::atomic<int> polledPresses(0);
+std::atomic<int> polledUndos(0);
+std::atomic<int> polledScrub(0);
+int pressesSeen = 0;
+int undosSeen = 0;
+
+//draws frames on this thread; hole-outs and bounces reach its effects from
+//the simulation through courseRenderer.queueEffect()
+CourseRenderer courseRenderer;
+Uint64 lastDrawTick = 0;
+
+//--fps <n> caps the frame rate (0 uncaps it), by default at the display's
+//refresh rate, or not at all with --vsync, where presenting waits instead
+FramePacer pacer;
+double targetFps = -1;
+bool vsync = false;
+//how long a still screen waits for input before drawing again anyway; the
+//title logo bobs so slowly that it only moves a pixel every few of these
+const int TITLE_IDLE_MS = 50;
+const int STILL_IDLE_MS = 500;
+
+//F3 toggles capture and the frame time overlay, F4 stops capture and writes the trace
+const char* traceFilePath = "trace.json";
+char profilerText[64] = "";
+int profilerTextAge = 0;
+//a steady frame allocates nothing, the overlay shows the most any recent frame did
+uint64_t frameAllocations = 0;
+uint64_t mostFrameAllocations = 0;
+
 
 SDL_Event event;
 
@@ -138,202 +235,427 @@ int state = 0; //0 = title screen, 1 = game, 2 = end screen
 Uint64 currentTick = SDL_GetPerformanceCounter();
 Uint64 lastTick = 0;
 double deltaTime = 0;
+double accumulator = 0;
 
-void loadLevel(int level)
+//rebuilds what is drawn from the level the session is on
+void loadEntities()
 {
-	if (level > 4)
+	if (session.finished)
 	{
 		state = 2;
 		return;
 	}
-	balls[0].setVelocity(0, 0);
-	balls[1].setVelocity(0,0);
-    balls[0].setScale(1, 1);
-	balls[1].setScale(1, 1);
-	balls[0].setWin(false);
-	balls[1].setWin(false);
-
-	tiles = loadTiles(level);
-
-	switch (level)
-	{
-		case 0:
-			balls[0].setPos(24 + 32*4, 24 + 32*11);
-			balls[1].setPos(24 + 32*4 + 32*10, 24 + 32*11);
-
-			holes.at(0).setPos(24 + 32*4, 22 + 32*2);
-			holes.at(1).setPos(24 + 32*4 + 32*10, 22 + 32*2);
-		break;
-		case 1:
-			balls[0].setPos(24 + 32*4, 24 + 32*11);
-			balls[1].setPos(24 + 32*4 + 32*10, 24 + 32*11);
-
-			holes.at(0).setPos(24 + 32*4, 22 + 32*2);
-			holes.at(1).setPos(24 + 32*4 + 32*10, 22 + 32*2);
-		break;
-		case 2:
-			balls[0].setPos(8 + 32*7, 8 + 32*10);
-			balls[1].setPos(8 + 32*7 + 32*10, 8 + 32*10);
-
-			holes.at(0).setPos(8 + 32*2, 6 + 32*5);
-			holes.at(1).setPos(8 + 32*4 + 32*10, 6 + 32*3);
-		break;
-		case 3:
-			balls[0].setPos(24 + 32*4, 24 + 32*5);
-			balls[1].setPos(24 + 32*4 + 32*10, 24 + 32*4);
-
-			holes.at(0).setPos(24 + 32*4, 22 + 32*1);
-			holes.at(1).setPos(24 + 32*4 + 32*10, 22 + 32*11);
-		break;
-		case 4:	
-			balls[0].setPos(24 + 32*2, 24 + 32*12);
-			balls[1].setPos(24 + 32*0 + 32*10, 24 + 32*5);
-
-			holes.at(0).setPos(24 + 32*1, 22 + 32*1);
-			holes.at(1).setPos(24 + 32*0 + 32*10, 22 + 32*7);
-		break;
-	}
+	levelEntityCount = loadLevelEntities(levelPack, session, entities);
+	levelLoads++;
+}
+
+void loadLevel(int level)
+{
+	session.loadLevel(level);
+	loadEntities();
 }
 
-const char* getStrokeText()
+//moves the session to p_tick of its history, or back to the last stroke when p_tick < 0
+void rewind(int p_tick)
 {
-	int biggestStroke = 0;
-	if (balls[1].getStrokes() > balls[0].getStrokes())
+	int level = session.level;
+	bool finished = session.finished;
+	if (!(p_tick < 0 ? history.undo(session) : history.seek(session, p_tick)))
 	{
-		biggestStroke = balls[1].getStrokes();
+		return;
 	}
-	else
+	session.events.clear();
+	accumulator = 0;
+	state = 1;
+	if (session.level != level || session.finished != finished)
 	{
-		biggestStroke = balls[0].getStrokes();
+		loadEntities();
+	}
+	for (Ball& b : session.balls)
+	{
+		b.interpolate(entities, 1);
+	}
+}
+
+void playEvents()
+{
+	for (SimEvent& e : session.events)
+	{
+		switch (e.type)
+		{
+			case SIM_EVENT_CHARGE:
+				soundQueue.play(SOUND_CHARGE, e.ball, e.pos.x);
+			break;
+			case SIM_EVENT_SWING:
+				soundQueue.play(SOUND_SWING, e.ball, e.pos.x);
+			break;
+			case SIM_EVENT_HOLE:
+				soundQueue.play(SOUND_HOLE, e.ball, e.pos.x);
+				courseRenderer.queueEffect(e);
+			break;
+			case SIM_EVENT_BOUNCE:
+				courseRenderer.queueEffect(e);
+			break;
+		}
 	}
-	std::string s = std::to_string(biggestStroke);
-	s = "STROKES: " + s;
-	return s.c_str();
+	session.events.clear();
+	soundQueue.send();
 }
 
-const char* getLevelText(int side)
+//courses only read the shared world, so they can step on any thread; the
+//events are merged in course order afterwards, keeping replays identical
+bool stepSession(const ShotInput& p_input)
 {
-	int tempLevel = (level + 1)*2 - 1;
-	if (side == 1)
+	if (jobs.getWorkerCount() == 0 || session.getCourseCount() < PARALLEL_COURSE_COUNT)
 	{
-		tempLevel++;
+		return session.step(p_input);
 	}
-	std::string s = std::to_string(tempLevel);
-	s = "HOLE: " + s;
-	return s.c_str();
+	SessionStep step = {&session, &p_input};
+	jobs.parallelFor(session.getCourseCount(), COURSES_PER_JOB, Session::stepCourses, &step);
+	return session.endStep();
 }
 
-void update()
+//versus: the local shot goes out on release, and the session runs as far
+//ahead as the peer's inputs allow
+void updateVersus(Vector2f p_mousePos)
 {
-	
-	lastTick = currentTick;
-	currentTick = SDL_GetPerformanceCounter();
-	deltaTime = (double)((currentTick - lastTick)*1000 / (double)SDL_GetPerformanceFrequency() );
+	int size;
+	while ((size = netSocket.receive(netPacket, sizeof(netPacket))) > 0)
+	{
+		lockstep->readPacket(netPacket, size);
+	}
 
+	const BallState& own = session.balls[lockstep->getPlayer()].getState();
+	if (mousePressed && own.canMove && !own.win)
+	{
+		localAiming = true;
+		aimStart = p_mousePos;
+	}
 	mousePressed = false;
-	//Get our controls and events
+	if (localAiming && !mouseDown)
+	{
+		localAiming = false;
+		lockstep->shoot(Vector2f(p_mousePos.x - aimStart.x, p_mousePos.y - aimStart.y));
+	}
+
+	accumulator += deltaTime;
+	if (lockstep->shouldWait())
+	{
+		accumulator -= SIM_STEP_MS;
+	}
+	int steps = 0;
+	while (accumulator >= SIM_STEP_MS && lockstep->canAdvance())
+	{
+		if (steps == MAX_SIM_STEPS_PER_FRAME)
+		{
+			accumulator = 0;
+			break;
+		}
+		lockstep->advance();
+		accumulator -= SIM_STEP_MS;
+		steps++;
+	}
+	//stalled on the peer, don't build up ticks to rush through later
+	if (accumulator > SIM_STEP_MS)
+	{
+		accumulator = SIM_STEP_MS;
+	}
+
+	size = lockstep->writePacket(netPacket, sizeof(netPacket));
+	netSocket.send(netPacket, size);
+}
+
+//Get our controls and events, for update() on whichever thread it runs
+void pollEvents()
+{
+	PROFILE_SCOPE("poll events");
+	bool polled = false;
 	while (SDL_PollEvent(&event))
 	{
+		polled = true;
 		switch(event.type)
 		{
 		case SDL_QUIT:
 			gameRunning = false;
 			break;
+		case SDL_RENDER_TARGETS_RESET:
+		case SDL_RENDER_DEVICE_RESET:
+			courseRenderer.invalidate();
+			break;
 		case SDL_MOUSEBUTTONDOWN:
 			if (event.button.button == SDL_BUTTON_LEFT)
 			{
-				mouseDown = true;
-				mousePressed = true;
+				polledMouseDown = true;
+				polledPresses++;
 			}
 			break;
 		case SDL_MOUSEBUTTONUP:
 			if (event.button.button == SDL_BUTTON_LEFT)
 			{
-				mouseDown = false;
+				polledMouseDown = false;
+			}
+			break;
+		case SDL_KEYDOWN:
+			if (event.key.keysym.sym == SDLK_F3)
+			{
+				setProfilerEnabled(!isProfilerEnabled());
+				profilerText[0] = '\0';
+			}
+			else if (event.key.keysym.sym == SDLK_F4)
+			{
+				//the other threads keep recording while capture runs, so it stops first
+				setProfilerEnabled(false);
+				profilerText[0] = '\0';
+				if (exportChromeTrace(traceFilePath))
+					std::cout << "Wrote " << traceFilePath << std::endl;
+				else
+					std::cout << "Failed to write " << traceFilePath << std::endl;
+			}
+			else if (event.key.keysym.sym == SDLK_BACKSPACE || (event.key.keysym.sym == SDLK_z && (event.key.keysym.mod & KMOD_CTRL)))
+			{
+				polledUndos++;
+			}
+			else if (event.key.keysym.sym == SDLK_LEFT || event.key.keysym.sym == SDLK_RIGHT)
+			{
+				polledScrub = event.key.keysym.sym == SDLK_LEFT ? -1 : 1;
+			}
+			break;
+		case SDL_KEYUP:
+			if (event.key.keysym.sym == SDLK_LEFT || event.key.keysym.sym == SDLK_RIGHT)
+			{
+				polledScrub = 0;
 			}
 			break;
 		}
 	}
+	int mouseX = 0;
+	int mouseY = 0;
+	SDL_GetMouseState(&mouseX, &mouseY);
+	polledMousePos = (mouseX & 0xffff) | mouseY << 16;
+	if (polled && inputReady != NULL)
+	{
+		SDL_SemPost(inputReady);
+	}
+}
 
+//how long the loop may block waiting for input, 0 while anything moves
+int getIdleTimeout()
+{
+	if (isProfilerEnabled() || mouseDown || lockstep != NULL || scrubDirection != 0)
+	{
+		return 0;
+	}
+	if (state == 0)
+	{
+		return SDL_GetTicks() >= 2000 && assetsLoaded ? TITLE_IDLE_MS : 0;
+	}
 	if (state == 1)
 	{
-		for (Ball& b : balls)
+		for (Ball& b : session.balls)
 		{
-			b.update(deltaTime, mouseDown, mousePressed, tiles, holes, chargeSfx, swingSfx, holeSfx);
+			const BallState& s = b.getState();
+			if (!s.canMove || s.win)
+			{
+				return 0;
+			}
 		}
-		if (balls[0].getScale().x < -1 && balls[1].getScale().x < -1)
- 		{
-        	level++;
-			loadLevel(level);
-    	}
 	}
+	return STILL_IDLE_MS;
 }
 
-void graphics()
+//copies what graphics() draws out of the session, for whichever thread draws it
+void publishFrame()
 {
-	window.clear();
-	window.render(0, 0, bgTexture);
-	for (Hole& h : holes)
+	PROFILE_SCOPE("publish");
+	FrameSnapshot& frame = frames.getBack();
+	copySession(session, entities, levelEntityCount, frame);
+	frame.levelLoads = levelLoads;
+	frame.state = state;
+	const char* hudText = state != 2 ? frame.strokeText : "";
+	if (state == 1 && lockstep != NULL && !lockstep->isConnected())
 	{
-		window.render(h);
+		hudText = "WAITING...";
 	}
-	for (Ball& b : balls)
+	SDL_strlcpy(frame.hudText, hudText, sizeof(frame.hudText));
+	frame.idleMs = getIdleTimeout();
+	//drawing may be blocked waiting for input on the last still frame
+	if (frame.idleMs == 0 && publishedIdleMs > 0 && simRunning)
 	{
-		if (!b.isWin())
+		SDL_Event wake;
+		SDL_zero(wake);
+		wake.type = SDL_USEREVENT;
+		SDL_PushEvent(&wake);
+	}
+	publishedIdleMs = frame.idleMs;
+	frames.publish();
+}
+
+void update()
+{
+	lastTick = currentTick;
+	currentTick = SDL_GetPerformanceCounter();
+	deltaTime = (double)((currentTick - lastTick)*1000 / (double)SDL_GetPerformanceFrequency() );
+
+	//take in what pollEvents() saw since the last update; a click only counts
+	//once, on the first step after it happened
+	mouseDown = polledMouseDown;
+	int packedPos = polledMousePos;
+	mousePos = Vector2f((int16_t)(packedPos & 0xffff), packedPos >> 16);
+	int presses = polledPresses;
+	if (presses != pressesSeen)
+	{
+		mousePressed = true;
+		pressesSeen = presses;
+	}
+	int undos = polledUndos;
+	for (; undosSeen != undos; undosSeen++)
+	{
+		if (historyEnabled)
+		{
+			rewind(-1);
+			scrubbing = true;
+		}
+	}
+	scrubDirection = historyEnabled ? (int)polledScrub : 0;
+	if (scrubDirection != 0)
+	{
+		scrubbing = true;
+	}
+
+	//the peer may still need our inputs after the last hole, so versus keeps
+	//running on the end screen too
+	if (lockstep != NULL)
+	{
+		PROFILE_SCOPE("versus");
+		//a rollback or resync can land on another level as well as a tick
+		int level = session.level;
+		bool finished = session.finished;
+		updateVersus(mousePos);
+		if (session.level != level || session.finished != finished)
+		{
+			state = 1;
+			loadEntities();
+		}
+		playEvents();
+		for (Ball& b : session.balls)
 		{
-			window.render(b.getPos().x, b.getPos().y + 4, ballShadowTexture);
+			b.interpolate(entities, accumulator/SIM_STEP_MS);
 		}
-		for (Entity& e : b.getPoints())
+		//the aim arrow and power bar follow the mouse before the shot is sent
+		const Ball& own = session.balls[lockstep->getPlayer()];
+		if (state == 1 && localAiming && mouseDown && own.getState().canMove)
 		{
-			window.render(e);
+			Ball preview = own;
+			aimBall(preview.getState(), Vector2f(mousePos.x - aimStart.x, mousePos.y - aimStart.y));
+			preview.interpolate(entities, 1);
 		}
-		window.render(b);
 	}
-	for (Tile& t : tiles)
-	{ 
-		window.render(t);
+	else if (scrubbing && mousePressed)
+	{
+		//the click that resumes play is a normal click, it can start a stroke
+		scrubbing = false;
+		accumulator = 0;
 	}
-	for (Ball& b : balls)
+	else if (scrubbing)
 	{
-		for (Entity& e : b.getPowerBar())
+		//ticks go by at the usual rate, just through the history instead
+		accumulator += deltaTime;
+		int ticks = accumulator/SIM_STEP_MS;
+		accumulator -= ticks*SIM_STEP_MS;
+		if (scrubDirection != 0 && ticks > 0)
 		{
-			window.render(e);
+			rewind(SDL_max(0, history.getTick() + scrubDirection*ticks));
 		}
-		window.render(b.getPowerBar().at(0).getPos().x, b.getPowerBar().at(0).getPos().y, powerMeterTexture_overlay);
-		
 	}
-	if (state != 2)
+	else if (state == 1)
 	{
-		window.render(640/4 - 132/2, 480 - 32, levelTextBgTexture);
-		window.renderCenter(-160, 240 - 16 + 3, getLevelText(0), font24, black);
-		window.renderCenter(-160, 240 - 16, getLevelText(0), font24, white);
+		ShotInput input;
+		input.mouseDown = mouseDown;
+		input.mousePos = mousePos;
+
+		//step the physics at a fixed rate so it behaves the same at any frame rate
+		accumulator += deltaTime;
+		int steps = 0;
+		PROFILE_SCOPE("simulate");
+		while (accumulator >= SIM_STEP_MS && state == 1)
+		{
+			if (steps == MAX_SIM_STEPS_PER_FRAME)
+			{
+				accumulator = 0;
+				break;
+			}
+			input.mousePressed = mousePressed;
+			mousePressed = false;
 
-		window.render(640/2 + 640/4 - 132/2, 480 - 32, levelTextBgTexture);
-		window.renderCenter(160, 240 - 16 + 3, getLevelText(1), font24, black);
-		window.renderCenter(160, 240 - 16, getLevelText(1), font24, white);
+			if (recordFilePath != NULL)
+			{
+				inputRecorder.record(input);
+			}
+			if (historyEnabled)
+			{
+				history.record(session, input);
+			}
+			if (stepSession(input))
+			{
+				loadEntities();
+			}
+			accumulator -= SIM_STEP_MS;
+			steps++;
+		}
+		playEvents();
 
-		window.render(640/2 - 196/2, 0, uiBgTexture);
-		window.renderCenter(0, -240 + 16 + 3, getStrokeText(), font24, black);
-		window.renderCenter(0, -240 + 16, getStrokeText(), font24, white);
+		for (Ball& b : session.balls)
+		{
+			b.interpolate(entities, accumulator/SIM_STEP_MS);
+		}
 	}
 	else
 	{
-		window.render(0, 0, endscreenOverlayTexture);
-		window.renderCenter(0, 3 - 32, "YOU COMPLETED THE COURSE!", font48, black);
-		window.renderCenter(0, -32, "YOU COMPLETED THE COURSE!", font48, white);
-		window.renderCenter(0, 3 + 32, getStrokeText(), font32, black);
-		window.renderCenter(0, 32, getStrokeText(), font32, white);
+		mousePressed = false;
+	}
+	publishFrame();
+}
+
+void renderProfiler()
+{
+	//only re-layout the text twice a second so the overlay doesn't churn the text cache
+	if (frameAllocations > mostFrameAllocations)
+	{
+		mostFrameAllocations = frameAllocations;
+	}
+	if (profilerText[0] == '\0' || ++profilerTextAge >= 30)
+	{
+		SDL_snprintf(profilerText, sizeof(profilerText), "P50 %.2fMS  P99 %.2fMS  ALLOCS %d", getFrameTimePercentile(50), getFrameTimePercentile(99), (int)mostFrameAllocations);
+		profilerTextAge = 0;
+		mostFrameAllocations = 0;
+	}
+	window.render(4 + 1, 4 + 1, profilerText, font24, black);
+	window.render(4, 4, profilerText, font24, white);
+}
+
+void graphics(const FrameSnapshot& p_frame)
+{
+	PROFILE_SCOPE("graphics");
+	Uint64 tick = SDL_GetPerformanceCounter();
+	//after idling, effects carry on from where they stopped rather than jumping ahead
+	float seconds = SDL_min(0.1f, (float)(tick - lastDrawTick)/SDL_GetPerformanceFrequency());
+	lastDrawTick = tick;
+	courseRenderer.draw(p_frame, seconds);
+	if (isProfilerEnabled())
+	{
+		renderProfiler();
 	}
 	window.display();
 }
 
 void titleScreen()
 {
-	if (SDL_GetTicks() < 2000)
+	finishLoading();
+	if (SDL_GetTicks() < 2000 || !assetsLoaded)
 	{
-		if (!swingPlayed)
+		if (!swingPlayed && assetsLoaded)
 		{
-			Mix_PlayChannel(-1, swingSfx, 0);
+			soundQueue.play(SOUND_SWING);
 			swingPlayed = true;
 		}
 		//Get our controls and events
@@ -348,8 +670,8 @@ void titleScreen()
 		}
 
 		window.clear();
-		window.render(0, 0, bgTexture);
-		window.render(0, 0, splashBgTexture);
+		window.render(0, 0, sprites[SPRITE_BG]);
+		window.render(0, 0, sprites[SPRITE_SPLASH_BG]);
 		window.renderCenter(0, 0 + 3, "POLYMARS", font32, black);
 		window.renderCenter(0, 0, "POLYMARS", font32, white);
 		window.display();
@@ -358,7 +680,7 @@ void titleScreen()
 	{
 		if (!secondSwingPlayed)
 		{
-			Mix_PlayChannel(-1, swingSfx, 0);
+			soundQueue.play(SOUND_SWING);
 			secondSwingPlayed = true;
 		}
 		lastTick = currentTick;
@@ -376,41 +698,263 @@ void titleScreen()
 			case SDL_MOUSEBUTTONDOWN:
 				if (event.button.button == SDL_BUTTON_LEFT)
 				{
-					Mix_PlayChannel(-1, holeSfx, 0);
+					soundQueue.play(SOUND_HOLE);
 					state = 1;
 				}
 				break;
 			}
 		}
 		window.clear();
-		window.render(0, 0, bgTexture);
-		window.render(320 - 160, 240 - 100 - 50 + 4*SDL_sin(SDL_GetTicks()*(3.14/1500)), logoTexture);
-		window.render(0, 0, click2start);
+		window.render(0, 0, sprites[SPRITE_BG]);
+		window.render(320 - 160, 240 - 100 - 50 + 4*SDL_sin(SDL_GetTicks()*(3.14/1500)), sprites[SPRITE_LOGO]);
+		window.render(0, 0, sprites[SPRITE_CLICK2START]);
 		window.renderCenter(0, 240 - 48 + 3 - 16*5, "LEFT CLICK TO START", font32, black);
 		window.renderCenter(0, 240 - 48 - 16*5, "LEFT CLICK TO START", font32, white);
 		window.display();
 	}
+	soundQueue.send();
 }
+//the simulation thread: updates whenever a tick is due or input arrives, and
+//sleeps for as long as nothing moves
+int simulationMain(void* p_data)
+{
+	while (simRunning)
+	{
+		update();
+		int idleMs = getIdleTimeout();
+		if (idleMs > 0)
+		{
+			SDL_SemWaitTimeout(inputReady, idleMs);
+			//same as the main loop's idle, resume one tick later
+			currentTick = SDL_GetPerformanceCounter() - (Uint64)(SDL_GetPerformanceFrequency()*SIM_STEP_MS/1000);
+		}
+		else
+		{
+			SDL_SemWaitTimeout(inputReady, SDL_max(1, (int)(SIM_STEP_MS - accumulator)));
+		}
+	}
+	return 0;
+}
+
+//hands the session over to the simulation thread; if it can't be started
+//game() keeps updating on this one
+void startSimulation()
+{
+	inputReady = SDL_CreateSemaphore(0);
+	if (inputReady == NULL)
+	{
+		return;
+	}
+	publishFrame();
+	simRunning = true;
+	simThread = SDL_CreateThread(simulationMain, "Simulation", NULL);
+	if (simThread == NULL)
+	{
+		simRunning = false;
+		SDL_DestroySemaphore(inputReady);
+		inputReady = NULL;
+	}
+}
+
+void stopSimulation()
+{
+	if (simThread == NULL)
+	{
+		return;
+	}
+	simRunning = false;
+	SDL_SemPost(inputReady);
+	SDL_WaitThread(simThread, NULL);
+	simThread = NULL;
+	SDL_DestroySemaphore(inputReady);
+	inputReady = NULL;
+}
+
+//pans each sound by where its ball is across the window
+void playSounds()
+{
+	SoundRequest request;
+	while (soundQueue.pop(request))
+	{
+		float pan = 0.5f;
+		if (request.course >= 0 && request.course < courseCount)
+		{
+			const ViewTransform& view = courseRenderer.getView(request.course);
+			pan = ((request.x + BALL_SIZE/2 - view.originX)*view.scale + view.viewport.x)/640;
+		}
+		voices.play(sounds[request.sound], request.sound, pan);
+	}
+}
+
 void game()
 {
-	if (state == 0)
+	uint64_t allocations = getAllocationCount();
+	profileFrame();
+	//once the simulation thread runs, state is its to read and write
+	if (simThread == NULL && state == 0)
 	{
 		titleScreen();
+		if (state != 0 && !singleThread)
+		{
+			startSimulation();
+		}
 	}
 	else
 	{
-		update();
-		graphics();
+		pollEvents();
+		if (simThread == NULL)
+		{
+			update();
+		}
+		frames.acquire();
+		graphics(frames.getFront());
 	}
+	playSounds();
+	frameAllocations = getAllocationCount() - allocations;
 }
 int main(int argc, char* args[])
 {
-	loadLevel(level);
+	for (int i = 1; i < argc; i++)
+	{
+		if (SDL_strcmp(args[i], "--profile") == 0)
+		{
+			setProfilerEnabled(true);
+		}
+		else if (SDL_strcmp(args[i], "--record") == 0 && i + 1 < argc)
+		{
+			recordFilePath = args[++i];
+		}
+		else if (SDL_strcmp(args[i], "--courses") == 0 && i + 1 < argc)
+		{
+			//SDL_max is a macro and would evaluate args[++i] twice
+			int value = SDL_atoi(args[++i]);
+			courseCount = SDL_min(MAX_COURSES, SDL_max(1, value));
+		}
+		else if (SDL_strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+		{
+			int value = SDL_atoi(args[++i]);
+			threadCount = SDL_max(0, value);
+		}
+		else if (SDL_strcmp(args[i], "--fps") == 0 && i + 1 < argc)
+		{
+			int value = SDL_atoi(args[++i]);
+			targetFps = SDL_max(0, value);
+		}
+		else if (SDL_strcmp(args[i], "--vsync") == 0)
+		{
+			vsync = true;
+		}
+		else if (SDL_strcmp(args[i], "--single-thread") == 0)
+		{
+			singleThread = true;
+		}
+		else if (SDL_strcmp(args[i], "--host") == 0 && i + 1 < argc)
+		{
+			hostPort = SDL_atoi(args[++i]);
+		}
+		else if (SDL_strcmp(args[i], "--join") == 0 && i + 2 < argc)
+		{
+			joinHost = args[++i];
+			joinPort = SDL_atoi(args[++i]);
+		}
+		else if (SDL_strcmp(args[i], "--input-delay") == 0 && i + 1 < argc)
+		{
+			int value = SDL_atoi(args[++i]);
+			inputDelay = SDL_max(0, value);
+		}
+		else if (SDL_strcmp(args[i], "--loss") == 0 && i + 1 < argc)
+		{
+			netLoss = SDL_atof(args[++i]);
+		}
+		else if (SDL_strcmp(args[i], "--latency") == 0 && i + 1 < argc)
+		{
+			int value = SDL_atoi(args[++i]);
+			netLatency = SDL_max(0, value);
+		}
+	}
+	bool versusMode = false;
+	if (hostPort > 0 || joinHost != NULL)
+	{
+		versusMode = joinHost != NULL ? netSocket.open(0) && netSocket.setPeer(joinHost, joinPort) : netSocket.open(hostPort);
+		if (versusMode)
+		{
+			netSocket.simulate(netLoss, netLatency);
+			courseCount = VERSUS_PLAYERS;
+		}
+	}
+	if (vsync && !window.setVSync(true))
+	{
+		vsync = false;
+	}
+	if (targetFps < 0)
+	{
+		targetFps = vsync ? 0 : window.getRefreshRate();
+	}
+	pacer.setTargetFps(targetFps);
+	jobs.start(threadCount);
+	voices.open(soundSettings);
+	courseRenderer.init(&window, sprites, font24, font32, font48, courseCount);
+	session.setCourseCount(courseCount, createBall());
+	reserveEntities(levelPack, courseCount, entities);
+	for (int i = 0; i < TripleBuffer<FrameSnapshot>::SLOT_COUNT; i++)
+	{
+		reserveFrame(levelPack, courseCount, frames.getSlot(i));
+	}
+
+	loadLevel(0);
+	inputRecorder.begin(session.level, courseCount);
+	//the host plays the first course
+	Lockstep versus(session, joinHost != NULL ? 1 : 0, inputDelay);
+	if (versusMode)
+	{
+		lockstep = &versus;
+		//a replay can't capture the peer's shots
+		recordFilePath = NULL;
+	}
+	historyEnabled = !versusMode && recordFilePath == NULL;
+	if (historyEnabled)
+	{
+		history.reset(session);
+	}
 	while (gameRunning)
 	{
 		game();
+		//with its own thread, the simulation says when nothing moves
+		int idleMs = simThread != NULL ? frames.getFront().idleMs : getIdleTimeout();
+		//effects keep moving after the ball stops
+		if (courseRenderer.hasEffects())
+		{
+			idleMs = 0;
+		}
+		if (idleMs > 0)
+		{
+			pacer.idle(idleMs);
+			//nothing moved while idle, so resume one tick later rather than
+			//catching up the whole wait; the input that woke us is simulated at once
+			if (simThread == NULL)
+			{
+				currentTick = SDL_GetPerformanceCounter() - (Uint64)(SDL_GetPerformanceFrequency()*SIM_STEP_MS/1000);
+			}
+		}
+		else
+		{
+			pacer.wait();
+		}
+	}
+	stopSimulation();
+
+	if (isProfilerEnabled())
+	{
+		setProfilerEnabled(false);
+		exportChromeTrace(traceFilePath);
+	}
+	if (recordFilePath != NULL)
+	{
+		inputRecorder.save(recordFilePath, session.hash());
 	}
 
+	jobs.stop();
+	courseRenderer.cleanUp();
 	window.cleanUp();
 	TTF_CloseFont(font32);
 	TTF_CloseFont(font24);
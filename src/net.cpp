@@ -0,0 +1,216 @@
+#include "Net.h"
+
+#include <chrono>
+#include <iostream>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+static const intptr_t NO_SOCKET = (intptr_t)INVALID_SOCKET;
+#elif !defined(__EMSCRIPTEN__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+static const intptr_t NO_SOCKET = -1;
+#else
+static const intptr_t NO_SOCKET = -1;
+#endif
+
+UdpSocket::UdpSocket()
+	:handle(NO_SOCKET), peerKnown(false), lossPercent(0), latencyMs(0), lossSeed(0x9e3779b9)
+{
+	memset(peer, 0, sizeof(peer));
+}
+
+UdpSocket::~UdpSocket()
+{
+	close();
+}
+
+bool UdpSocket::open(int p_port)
+{
+#if defined(__EMSCRIPTEN__)
+	(void)p_port;
+	std::cout << "Networking is not available in this build" << std::endl;
+	return false;
+#else
+	close();
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+	{
+		std::cout << "WSAStartup has failed" << std::endl;
+		return false;
+	}
+#endif
+	handle = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == NO_SOCKET)
+	{
+		std::cout << "Failed to create socket" << std::endl;
+		return false;
+	}
+	sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(p_port);
+	if (bind(handle, (sockaddr*)&local, sizeof(local)) != 0)
+	{
+		std::cout << "Failed to bind port " << p_port << std::endl;
+		close();
+		return false;
+	}
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+	fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+	return true;
+#endif
+}
+
+bool UdpSocket::setPeer(const char* p_host, int p_port)
+{
+#if defined(__EMSCRIPTEN__)
+	(void)p_host;
+	(void)p_port;
+	return false;
+#else
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* found = NULL;
+	if (getaddrinfo(p_host, NULL, &hints, &found) != 0 || found == NULL)
+	{
+		std::cout << "Failed to resolve " << p_host << std::endl;
+		return false;
+	}
+	sockaddr_in address;
+	memcpy(&address, found->ai_addr, sizeof(address));
+	freeaddrinfo(found);
+	address.sin_port = htons(p_port);
+	memcpy(peer, &address, sizeof(address));
+	peerKnown = true;
+	return true;
+#endif
+}
+
+void UdpSocket::close()
+{
+	if (handle == NO_SOCKET)
+	{
+		return;
+	}
+#if defined(_WIN32)
+	closesocket(handle);
+	WSACleanup();
+#elif !defined(__EMSCRIPTEN__)
+	::close(handle);
+#endif
+	handle = NO_SOCKET;
+	delayed.clear();
+}
+
+int64_t UdpSocket::nowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void UdpSocket::simulate(float p_lossPercent, int p_latencyMs)
+{
+	lossPercent = p_lossPercent;
+	latencyMs = p_latencyMs;
+	delayed.reserve(256);
+}
+
+void UdpSocket::send(const uint8_t* p_data, int p_size)
+{
+	if (handle == NO_SOCKET || !peerKnown || p_size > MAX_PACKET_SIZE)
+	{
+		return;
+	}
+	if (lossPercent > 0)
+	{
+		lossSeed ^= lossSeed << 13;
+		lossSeed ^= lossSeed >> 17;
+		lossSeed ^= lossSeed << 5;
+		if ((lossSeed % 10000) < lossPercent*100)
+		{
+			return;
+		}
+	}
+	if (latencyMs <= 0)
+	{
+		sendNow(p_data, p_size);
+		return;
+	}
+	DelayedPacket packet;
+	packet.due = nowMs() + latencyMs;
+	packet.size = p_size;
+	memcpy(packet.data, p_data, p_size);
+	delayed.push_back(packet);
+}
+
+void UdpSocket::sendNow(const uint8_t* p_data, int p_size)
+{
+#if !defined(__EMSCRIPTEN__)
+	sendto(handle, (const char*)p_data, p_size, 0, (const sockaddr*)peer, sizeof(sockaddr_in));
+#else
+	(void)p_data;
+	(void)p_size;
+#endif
+}
+
+int UdpSocket::receive(uint8_t* p_data, int p_size)
+{
+	if (handle == NO_SOCKET)
+	{
+		return 0;
+	}
+	//the latency simulator's queue goes out in order as packets fall due
+	if (!delayed.empty())
+	{
+		int64_t now = nowMs();
+		unsigned int sent = 0;
+		while (sent < delayed.size() && delayed[sent].due <= now)
+		{
+			sendNow(delayed[sent].data, delayed[sent].size);
+			sent++;
+		}
+		delayed.erase(delayed.begin(), delayed.begin() + sent);
+	}
+#if !defined(__EMSCRIPTEN__)
+	while (true)
+	{
+		sockaddr_in from;
+		socklen_t fromSize = sizeof(from);
+		int size = recvfrom(handle, (char*)p_data, p_size, 0, (sockaddr*)&from, &fromSize);
+		if (size <= 0)
+		{
+			return 0;
+		}
+		if (!peerKnown)
+		{
+			memcpy(peer, &from, sizeof(from));
+			peerKnown = true;
+		}
+		//a packet from anyone other than the peer is dropped, returning 0 for
+		//it would end the caller's loop with the peer's packets still queued
+		if (memcmp(peer, &from, sizeof(from)) == 0)
+		{
+			return size;
+		}
+	}
+#else
+	(void)p_data;
+	(void)p_size;
+	return 0;
+#endif
+}
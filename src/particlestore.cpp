@@ -0,0 +1,109 @@
+#include "ParticleStore.h"
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+
+void ParticleStore::reserve(int p_capacity)
+{
+	capacity = p_capacity;
+	posX.resize(p_capacity);
+	posY.resize(p_capacity);
+	velX.resize(p_capacity);
+	velY.resize(p_capacity);
+	age.resize(p_capacity);
+	life.resize(p_capacity);
+	scale.resize(p_capacity);
+	sprite.resize(p_capacity);
+	course.resize(p_capacity);
+	if (count > capacity)
+	{
+		count = capacity;
+	}
+}
+
+bool ParticleStore::emit(int p_course, int p_sprite, float p_x, float p_y, float p_velX, float p_velY, float p_life, float p_scale)
+{
+	if (count == capacity)
+	{
+		return false;
+	}
+	int i = count++;
+	posX[i] = p_x;
+	posY[i] = p_y;
+	velX[i] = p_velX;
+	velY[i] = p_velY;
+	age[i] = 0;
+	life[i] = p_life;
+	scale[i] = p_scale;
+	sprite[i] = p_sprite;
+	course[i] = p_course;
+	return true;
+}
+
+//xorshift, only ever used for how effects look
+static float nextRandom(uint32_t& p_state)
+{
+	p_state ^= p_state << 13;
+	p_state ^= p_state >> 17;
+	p_state ^= p_state << 5;
+	return (p_state >> 8)*(1.0f/16777216);
+}
+
+void ParticleStore::burst(int p_course, int p_sprite, float p_x, float p_y, int p_count, float p_speed, float p_life, float p_scale)
+{
+	for (int i = 0; i < p_count; i++)
+	{
+		float angle = nextRandom(random)*6.2831853f;
+		float speed = p_speed*(0.3f + 0.7f*nextRandom(random));
+		float life = p_life*(0.6f + 0.4f*nextRandom(random));
+		if (!emit(p_course, p_sprite, p_x, p_y, std::cos(angle)*speed, std::sin(angle)*speed, life, p_scale))
+		{
+			return;
+		}
+	}
+}
+
+void ParticleStore::update(float p_seconds)
+{
+	//one damping factor for the frame instead of an exp per particle
+	float damping = 1 - drag*p_seconds;
+	if (damping < 0)
+	{
+		damping = 0;
+	}
+	float* x = posX.data();
+	float* y = posY.data();
+	float* vx = velX.data();
+	float* vy = velY.data();
+	float* a = age.data();
+	//no branches or calls, so this becomes a few SIMD instructions per 4 or 8 particles
+	for (int i = 0; i < count; i++)
+	{
+		vx[i] *= damping;
+		vy[i] *= damping;
+		x[i] += vx[i]*p_seconds;
+		y[i] += vy[i]*p_seconds;
+		a[i] += p_seconds;
+	}
+
+	//order doesn't matter, so the last live particle takes a dead one's place
+	for (int i = 0; i < count;)
+	{
+		if (age[i] < life[i])
+		{
+			i++;
+			continue;
+		}
+		int last = --count;
+		posX[i] = posX[last];
+		posY[i] = posY[last];
+		velX[i] = velX[last];
+		velY[i] = velY[last];
+		age[i] = age[last];
+		life[i] = life[last];
+		scale[i] = scale[last];
+		sprite[i] = sprite[last];
+		course[i] = course[last];
+	}
+}
@@ -0,0 +1,134 @@
+#include "Profiler.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+struct ProfileBuffer
+{
+	ProfileEvent events[PROFILE_BUFFER_SIZE];
+	std::atomic<uint32_t> head;
+	int threadId;
+	ProfileBuffer* next;
+};
+
+std::atomic<bool> profilerEnabled(false);
+
+//buffers are pushed onto this list once per thread and never freed
+static std::atomic<ProfileBuffer*> profileBuffers(nullptr);
+static std::atomic<int> nextThreadId(0);
+static thread_local ProfileBuffer* localBuffer = nullptr;
+
+static int64_t lastFrameTime = -1;
+static float frameTimes[PROFILE_FRAME_HISTORY];
+static int frameCount = 0;
+
+void setProfilerEnabled(bool p_enabled)
+{
+	profilerEnabled.store(p_enabled, std::memory_order_relaxed);
+	lastFrameTime = -1;
+}
+
+int64_t getProfileTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void recordProfileEvent(const char* p_name, int64_t p_start, int64_t p_end)
+{
+	ProfileBuffer* buffer = localBuffer;
+	if (buffer == nullptr)
+	{
+		buffer = new ProfileBuffer();
+		buffer->head.store(0, std::memory_order_relaxed);
+		buffer->threadId = nextThreadId.fetch_add(1);
+		buffer->next = profileBuffers.load();
+		while (!profileBuffers.compare_exchange_weak(buffer->next, buffer))
+		{
+		}
+		localBuffer = buffer;
+	}
+
+	uint32_t head = buffer->head.load(std::memory_order_relaxed);
+	ProfileEvent& e = buffer->events[head % PROFILE_BUFFER_SIZE];
+	e.name = p_name;
+	e.start = p_start;
+	e.end = p_end;
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void profileFrame()
+{
+	if (!isProfilerEnabled())
+	{
+		return;
+	}
+	int64_t now = getProfileTime();
+	if (lastFrameTime >= 0)
+	{
+		frameTimes[frameCount % PROFILE_FRAME_HISTORY] = (now - lastFrameTime)/1000000.0f;
+		frameCount++;
+		recordProfileEvent("frame", lastFrameTime, now);
+	}
+	lastFrameTime = now;
+}
+
+float getFrameTimePercentile(float p_percentile)
+{
+	int count = std::min(frameCount, PROFILE_FRAME_HISTORY);
+	if (count == 0)
+	{
+		return 0;
+	}
+	float sorted[PROFILE_FRAME_HISTORY];
+	std::copy(frameTimes, frameTimes + count, sorted);
+	std::sort(sorted, sorted + count);
+	int index = (int)(p_percentile/100*(count - 1) + 0.5f);
+	return sorted[index];
+}
+
+//Meant to run once capture is stopped; events a thread writes meanwhile may
+//show up torn or be missing.
+bool exportChromeTrace(const char* p_filePath)
+{
+	std::ofstream out(p_filePath);
+	if (!out)
+	{
+		return false;
+	}
+
+	int64_t origin = -1;
+	for (ProfileBuffer* b = profileBuffers.load(); b != nullptr; b = b->next)
+	{
+		uint32_t head = b->head.load(std::memory_order_acquire);
+		uint32_t count = std::min<uint32_t>(head, PROFILE_BUFFER_SIZE);
+		for (uint32_t i = head - count; i != head; i++)
+		{
+			int64_t start = b->events[i % PROFILE_BUFFER_SIZE].start;
+			if (origin < 0 || start < origin)
+			{
+				origin = start;
+			}
+		}
+	}
+
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (ProfileBuffer* b = profileBuffers.load(); b != nullptr; b = b->next)
+	{
+		uint32_t head = b->head.load(std::memory_order_acquire);
+		uint32_t count = std::min<uint32_t>(head, PROFILE_BUFFER_SIZE);
+		for (uint32_t i = head - count; i != head; i++)
+		{
+			const ProfileEvent& e = b->events[i % PROFILE_BUFFER_SIZE];
+			out << (first ? "\n" : ",\n");
+			out << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->threadId
+				<< ",\"ts\":" << (e.start - origin)/1000.0 << ",\"dur\":" << (e.end - e.start)/1000.0 << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+	return (bool)out;
+}
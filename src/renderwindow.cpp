@@ -4,7 +4,8 @@
 #include <iostream>
 
 #include "RenderWindow.h"
-#include "Entity.h"
+#include "EntityStore.h"
+#include "Profiler.h"
 
 RenderWindow::RenderWindow(const char* p_title, int p_w, int p_h)
 	:window(NULL), renderer(NULL)
@@ -17,6 +18,7 @@ RenderWindow::RenderWindow(const char* p_title, int p_w, int p_h)
 	}
 
 	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+	textCache.reserve(TEXT_CACHE_SIZE);
 }
 
 SDL_Texture* RenderWindow::loadTexture(const char* p_filePath)
@@ -30,97 +32,670 @@ SDL_Texture* RenderWindow::loadTexture(const char* p_filePath)
 	return texture;
 }
 
+bool RenderWindow::loadAtlas(const char* const* p_filePaths, int p_count)
+{
+	std::vector<SDL_Surface*> surfaces;
+	for (int i = 0; i < p_count; i++)
+	{
+		SDL_Surface* surface = IMG_Load(p_filePaths[i]);
+		if (surface == NULL)
+			std::cout << "Failed to load texture. Error: " << SDL_GetError() << std::endl;
+		surfaces.push_back(surface);
+	}
+
+	bool success = buildAtlas(p_filePaths, surfaces.data(), p_count);
+	for (SDL_Surface* surface : surfaces)
+	{
+		SDL_FreeSurface(surface);
+	}
+	return success;
+}
+
+bool RenderWindow::buildAtlas(const char* const* p_names, SDL_Surface* const* p_surfaces, int p_count)
+{
+	std::vector<int> order;
+	for (int i = 0; i < p_count; i++)
+	{
+		SDL_Surface* surface = p_surfaces[i];
+		order.push_back(i);
+
+		AtlasEntry entry;
+		entry.path = p_names[i];
+		entry.sprite.tex = NULL;
+		entry.sprite.frame.x = 0;
+		entry.sprite.frame.y = 0;
+		entry.sprite.frame.w = surface != NULL ? surface->w : 0;
+		entry.sprite.frame.h = surface != NULL ? surface->h : 0;
+		atlasEntries.push_back(entry);
+	}
+	int first = atlasEntries.size() - p_count;
+
+	SDL_RendererInfo info;
+	int pageSize = ATLAS_PAGE_SIZE;
+	if (SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_width > 0)
+	{
+		pageSize = SDL_min(pageSize, SDL_min(info.max_texture_width, info.max_texture_height));
+	}
+
+	//shelf packing, tallest images first
+	for (unsigned int i = 1; i < order.size(); i++)
+	{
+		for (unsigned int j = i; j > 0 && atlasEntries[first + order[j]].sprite.frame.h > atlasEntries[first + order[j - 1]].sprite.frame.h; j--)
+		{
+			int temp = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = temp;
+		}
+	}
+
+	bool success = true;
+	for (int i = 0; i < p_count; i++)
+	{
+		success = success && p_surfaces[i] != NULL;
+	}
+	unsigned int pageStart = 0;
+	while (pageStart < order.size())
+	{
+		int x = 0;
+		int y = 0;
+		int shelfH = 0;
+		unsigned int pageEnd = pageStart;
+		for (; pageEnd < order.size(); pageEnd++)
+		{
+			SDL_Rect& r = atlasEntries[first + order[pageEnd]].sprite.frame;
+			if (x + r.w > pageSize)
+			{
+				x = 0;
+				y += shelfH + 1;
+				shelfH = 0;
+			}
+			if (y + r.h > pageSize)
+			{
+				break;
+			}
+			r.x = x;
+			r.y = y;
+			x += r.w + 1;
+			if (r.h > shelfH)
+			{
+				shelfH = r.h;
+			}
+		}
+		if (pageEnd == pageStart)
+		{
+			std::cout << "Image does not fit in an atlas page: " << atlasEntries[first + order[pageStart]].path << std::endl;
+			pageEnd++;
+			success = false;
+			pageStart = pageEnd;
+			continue;
+		}
+
+		SDL_Texture* page = NULL;
+		SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, pageSize, y + shelfH, 32, SDL_PIXELFORMAT_RGBA32);
+		if (sheet == NULL)
+		{
+			std::cout << "Failed to create atlas page. Error: " << SDL_GetError() << std::endl;
+			success = false;
+		}
+		else
+		{
+			for (unsigned int i = pageStart; i < pageEnd; i++)
+			{
+				SDL_Surface* surface = p_surfaces[order[i]];
+				if (surface != NULL)
+				{
+					SDL_Rect dst = atlasEntries[first + order[i]].sprite.frame;
+					SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+					SDL_BlitSurface(surface, NULL, sheet, &dst);
+				}
+			}
+			page = SDL_CreateTextureFromSurface(renderer, sheet);
+			SDL_SetTextureBlendMode(page, SDL_BLENDMODE_BLEND);
+			SDL_FreeSurface(sheet);
+			atlasPages.push_back(page);
+		}
+
+		for (unsigned int i = pageStart; i < pageEnd; i++)
+		{
+			if (p_surfaces[order[i]] != NULL)
+			{
+				atlasEntries[first + order[i]].sprite.tex = page;
+			}
+		}
+		pageStart = pageEnd;
+	}
+	return success;
+}
+
+Sprite RenderWindow::getSprite(const char* p_filePath)
+{
+	for (AtlasEntry& e : atlasEntries)
+	{
+		if (e.path == p_filePath)
+		{
+			return e.sprite;
+		}
+	}
+
+	std::cout << "Sprite is not in the atlas: " << p_filePath << std::endl;
+	Sprite empty;
+	empty.tex = NULL;
+	empty.frame.x = 0;
+	empty.frame.y = 0;
+	empty.frame.w = 0;
+	empty.frame.h = 0;
+	return empty;
+}
+
 void RenderWindow::cleanUp()
 {
+	for (SDL_Texture* page : atlasPages)
+	{
+		SDL_DestroyTexture(page);
+	}
+	atlasPages.clear();
+	atlasEntries.clear();
+	for (GlyphAtlas& a : glyphAtlases)
+	{
+		SDL_DestroyTexture(a.tex);
+	}
+	glyphAtlases.clear();
+	textCache.clear();
 	SDL_DestroyWindow(window);
 }
 
+bool RenderWindow::setVSync(bool p_vsync)
+{
+	if (SDL_RenderSetVSync(renderer, p_vsync ? 1 : 0) != 0)
+	{
+		std::cout << "Failed to set vsync. Error: " << SDL_GetError() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//of the display the window is on, 60 when the driver doesn't say
+int RenderWindow::getRefreshRate()
+{
+	SDL_DisplayMode mode;
+	if (SDL_GetWindowDisplayMode(window, &mode) != 0 || mode.refresh_rate <= 0)
+	{
+		return 60;
+	}
+	return mode.refresh_rate;
+}
+
 void RenderWindow::clear()
 {
+	batchVertices.clear();
+	batchIndices.clear();
 	SDL_RenderClear(renderer);
 }
 
-void RenderWindow::render(Entity& p_entity)
+//quads batch up until one needs another texture
+void RenderWindow::batchTexture(SDL_Texture* p_tex)
 {
-	SDL_Rect src; 
-	src.x = p_entity.getCurrentFrame().x;
-	src.y = p_entity.getCurrentFrame().y;
-	src.w = p_entity.getCurrentFrame().w;
-	src.h = p_entity.getCurrentFrame().h;
+	if (p_tex != batchTex)
+	{
+		flushBatch();
+		batchTex = p_tex;
+		SDL_QueryTexture(p_tex, NULL, NULL, &batchTexW, &batchTexH);
+	}
+}
 
-	SDL_Rect dst;
-	dst.x = p_entity.getPos().x + (p_entity.getCurrentFrame().w - p_entity.getCurrentFrame().w*p_entity.getScale().x)/2;
-	dst.y = p_entity.getPos().y + (p_entity.getCurrentFrame().h - p_entity.getCurrentFrame().h*p_entity.getScale().y)/2;
-	dst.w = p_entity.getCurrentFrame().w*p_entity.getScale().x;
-	dst.h = p_entity.getCurrentFrame().h*p_entity.getScale().y;
+void RenderWindow::batchQuad(SDL_Texture* p_tex, const SDL_Rect& p_src, const SDL_Rect& p_dst, float p_angle)
+{
+	if (p_tex == NULL || p_dst.w <= 0 || p_dst.h <= 0)
+	{
+		return;
+	}
+	batchTexture(p_tex);
+
+	float u0 = (float)p_src.x/batchTexW;
+	float v0 = (float)p_src.y/batchTexH;
+	float u1 = (float)(p_src.x + p_src.w)/batchTexW;
+	float v1 = (float)(p_src.y + p_src.h)/batchTexH;
+
+	//rotate around the centre of dst, clockwise like SDL_RenderCopyEx
+	float centerX = p_dst.x + p_dst.w/2.0f;
+	float centerY = p_dst.y + p_dst.h/2.0f;
+	float halfW = p_dst.w/2.0f;
+	float halfH = p_dst.h/2.0f;
+	float c = 1;
+	float s = 0;
+	if (p_angle != 0)
+	{
+		c = SDL_cos(p_angle*M_PI/180);
+		s = SDL_sin(p_angle*M_PI/180);
+	}
+
+	const float cornersX[4] = {-halfW, halfW, halfW, -halfW};
+	const float cornersY[4] = {-halfH, -halfH, halfH, halfH};
+	const float cornersU[4] = {u0, u1, u1, u0};
+	const float cornersV[4] = {v0, v0, v1, v1};
+
+	int first = batchVertices.size();
+	SDL_Vertex v;
+	v.color.r = 255;
+	v.color.g = 255;
+	v.color.b = 255;
+	v.color.a = 255;
+	for (int i = 0; i < 4; i++)
+	{
+		v.position.x = (centerX + cornersX[i]*c - cornersY[i]*s - viewOriginX)*viewScale + viewX;
+		v.position.y = (centerY + cornersX[i]*s + cornersY[i]*c - viewOriginY)*viewScale + viewY;
+		v.tex_coord.x = cornersU[i];
+		v.tex_coord.y = cornersV[i];
+		batchVertices.push_back(v);
+	}
+	batchIndices.push_back(first);
+	batchIndices.push_back(first + 1);
+	batchIndices.push_back(first + 2);
+	batchIndices.push_back(first);
+	batchIndices.push_back(first + 2);
+	batchIndices.push_back(first + 3);
+}
+
+void RenderWindow::flushBatch()
+{
+	PROFILE_SCOPE("RenderGeometry");
+	if (!batchIndices.empty())
+	{
+		SDL_RenderGeometry(renderer, batchTex, batchVertices.data(), batchVertices.size(), batchIndices.data(), batchIndices.size());
+	}
+	batchVertices.clear();
+	batchIndices.clear();
+}
+
+//maps the playfield starting at origin into p_viewport, until resetView()
+void RenderWindow::setView(const SDL_Rect& p_viewport, float p_originX, float p_originY, float p_scale, bool p_clip)
+{
+	flushBatch();
+	SDL_RenderSetClipRect(renderer, p_clip ? &p_viewport : NULL);
+	viewX = p_viewport.x;
+	viewY = p_viewport.y;
+	viewOriginX = p_originX;
+	viewOriginY = p_originY;
+	viewScale = p_scale;
+}
+
+void RenderWindow::resetView()
+{
+	flushBatch();
+	SDL_RenderSetClipRect(renderer, NULL);
+	viewX = 0;
+	viewY = 0;
+	viewOriginX = 0;
+	viewOriginY = 0;
+	viewScale = 1;
+}
+
+void RenderWindow::render(const EntityStore& p_store, const Sprite* p_sprites, int p_kind)
+{
+	render(p_store, p_sprites, p_kind, 0, p_store.size());
+}
+
+void RenderWindow::render(const EntityStore& p_store, const Sprite* p_sprites, int p_kind, int p_first, int p_count)
+{
+	for (int i = p_first; i < p_first + p_count; i++)
+	{
+		if (p_store.kind[i] != p_kind || (p_store.flags[i] & ENTITY_HIDDEN))
+		{
+			continue;
+		}
+
+		const Sprite& sprite = p_sprites[p_store.sprite[i]];
+		const SDL_Rect& src = sprite.frame;
 
-	SDL_RenderCopyEx(renderer, p_entity.getTex(), &src, &dst, p_entity.getAngle(), 0, SDL_FLIP_NONE);
+		SDL_Rect dst;
+		dst.x = p_store.posX[i] + (src.w - src.w*p_store.scaleX[i])/2;
+		dst.y = p_store.posY[i] + (src.h - src.h*p_store.scaleY[i])/2;
+		dst.w = src.w*p_store.scaleX[i];
+		dst.h = src.h*p_store.scaleY[i];
+
+		batchQuad(sprite.tex, src, dst, p_store.angle[i]);
+	}
 }
 
-void RenderWindow::render(int x, int y, SDL_Texture* p_tex)
+//Every particle in the view of its own course, shrinking and fading out over
+//its life. Particles of all courses share one batch, so they take a single
+//submission per texture; ones whose centre is outside their course's viewport
+//are skipped instead of clipped.
+void RenderWindow::render(const ParticleStore& p_particles, const Sprite* p_sprites, const ViewTransform* p_views)
 {
-	SDL_Rect src; 
-	src.x = 0;
-	src. y = 0;
-	src.w;
-	src.h;
+	resetView();
+	SDL_Vertex v;
+	v.color.r = 255;
+	v.color.g = 255;
+	v.color.b = 255;
+	for (int i = 0; i < p_particles.count; i++)
+	{
+		const ViewTransform& view = p_views[p_particles.course[i]];
+		float x = (p_particles.posX[i] - view.originX)*view.scale + view.viewport.x;
+		float y = (p_particles.posY[i] - view.originY)*view.scale + view.viewport.y;
+		if (x < view.viewport.x || y < view.viewport.y || x >= view.viewport.x + view.viewport.w || y >= view.viewport.y + view.viewport.h)
+		{
+			continue;
+		}
+		const Sprite& sprite = p_sprites[p_particles.sprite[i]];
+		if (sprite.tex == NULL)
+		{
+			continue;
+		}
+		batchTexture(sprite.tex);
 
-	SDL_QueryTexture(p_tex, NULL, NULL, &src.w, &src.h);
+		float fade = 1 - p_particles.age[i]/p_particles.life[i];
+		float halfW = sprite.frame.w*p_particles.scale[i]*fade*view.scale/2;
+		float halfH = sprite.frame.h*p_particles.scale[i]*fade*view.scale/2;
+		float u0 = (float)sprite.frame.x/batchTexW;
+		float v0 = (float)sprite.frame.y/batchTexH;
+		float u1 = (float)(sprite.frame.x + sprite.frame.w)/batchTexW;
+		float v1 = (float)(sprite.frame.y + sprite.frame.h)/batchTexH;
+		v.color.a = 255*fade;
 
+		int first = batchVertices.size();
+		v.position.x = x - halfW;
+		v.position.y = y - halfH;
+		v.tex_coord.x = u0;
+		v.tex_coord.y = v0;
+		batchVertices.push_back(v);
+		v.position.x = x + halfW;
+		v.tex_coord.x = u1;
+		batchVertices.push_back(v);
+		v.position.y = y + halfH;
+		v.tex_coord.y = v1;
+		batchVertices.push_back(v);
+		v.position.x = x - halfW;
+		v.tex_coord.x = u0;
+		batchVertices.push_back(v);
+		batchIndices.push_back(first);
+		batchIndices.push_back(first + 1);
+		batchIndices.push_back(first + 2);
+		batchIndices.push_back(first);
+		batchIndices.push_back(first + 2);
+		batchIndices.push_back(first + 3);
+	}
+	flushBatch();
+}
+
+void RenderWindow::render(int x, int y, Sprite p_sprite)
+{
 	SDL_Rect dst;
 	dst.x = x;
 	dst.y = y;
-	dst.w = src.w;
-	dst.h = src.h;
+	dst.w = p_sprite.frame.w;
+	dst.h = p_sprite.frame.h;
 
-	SDL_RenderCopy(renderer, p_tex, &src, &dst);
+	batchQuad(p_sprite.tex, p_sprite.frame, dst, 0);
 }
 
-void RenderWindow::render(float p_x, float p_y, const char* p_text, TTF_Font* font, SDL_Color textColor)
+int RenderWindow::getGlyphAtlas(TTF_Font* font, SDL_Color textColor)
 {
-		SDL_Surface* surfaceMessage = TTF_RenderText_Blended( font, p_text, textColor);
-		SDL_Texture* message = SDL_CreateTextureFromSurface(renderer, surfaceMessage);
+	for (unsigned int i = 0; i < glyphAtlases.size(); i++)
+	{
+		SDL_Color& c = glyphAtlases[i].color;
+		if (glyphAtlases[i].font == font && c.r == textColor.r && c.g == textColor.g && c.b == textColor.b && c.a == textColor.a)
+		{
+			return i;
+		}
+	}
 
-		SDL_Rect src;
-		src.x = 0;
-		src.y = 0;
-		src.w = surfaceMessage->w;
-		src.h = surfaceMessage->h; 
+	PROFILE_SCOPE("TTF glyph atlas");
+	GlyphAtlas atlas;
+	atlas.font = font;
+	atlas.color = textColor;
+	atlas.tex = NULL;
 
-		SDL_Rect dst;
-		dst.x = p_x;
-		dst.y = p_y;
-		dst.w = src.w;
-		dst.h = src.h;
+	SDL_Surface* glyphSurfaces[GLYPH_COUNT];
+	int x = 0;
+	int y = 0;
+	int rowH = 0;
+	for (int i = 0; i < GLYPH_COUNT; i++)
+	{
+		Uint16 ch = FIRST_GLYPH + i;
+		int minX, maxX, minY, maxY, advance;
+		atlas.advances[i] = 0;
+		if (TTF_GlyphMetrics(font, ch, &minX, &maxX, &minY, &maxY, &advance) == 0)
+		{
+			atlas.advances[i] = advance;
+		}
+
+		SDL_Rect& r = atlas.glyphs[i];
+		r.x = 0;
+		r.y = 0;
+		r.w = 0;
+		r.h = 0;
+		glyphSurfaces[i] = TTF_RenderGlyph_Blended(font, ch, textColor);
+		if (glyphSurfaces[i] == NULL)
+		{
+			continue;
+		}
+
+		r.w = glyphSurfaces[i]->w;
+		r.h = glyphSurfaces[i]->h;
+		if (x + r.w > GLYPH_ATLAS_WIDTH)
+		{
+			x = 0;
+			y += rowH + 1;
+			rowH = 0;
+		}
+		r.x = x;
+		r.y = y;
+		x += r.w + 1;
+		if (r.h > rowH)
+		{
+			rowH = r.h;
+		}
+	}
+
+	SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, GLYPH_ATLAS_WIDTH, y + rowH, 32, SDL_PIXELFORMAT_RGBA32);
+	for (int i = 0; i < GLYPH_COUNT; i++)
+	{
+		if (glyphSurfaces[i] == NULL)
+		{
+			continue;
+		}
+		if (sheet != NULL)
+		{
+			SDL_Rect dst = atlas.glyphs[i];
+			SDL_SetSurfaceBlendMode(glyphSurfaces[i], SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(glyphSurfaces[i], NULL, sheet, &dst);
+		}
+		SDL_FreeSurface(glyphSurfaces[i]);
+	}
+
+	if (sheet == NULL)
+	{
+		std::cout << "Failed to build glyph atlas. Error: " << SDL_GetError() << std::endl;
+	}
+	else
+	{
+		atlas.tex = SDL_CreateTextureFromSurface(renderer, sheet);
+		SDL_SetTextureBlendMode(atlas.tex, SDL_BLENDMODE_BLEND);
+		SDL_FreeSurface(sheet);
+	}
+
+	glyphAtlases.push_back(atlas);
+	return glyphAtlases.size() - 1;
+}
+
+TextLayout& RenderWindow::getTextLayout(const char* p_text, TTF_Font* font, SDL_Color textColor)
+{
+	textCacheClock++;
+	int atlasIndex = getGlyphAtlas(font, textColor);
+	for (TextLayout& l : textCache)
+	{
+		if (l.atlas == atlasIndex && l.text == p_text)
+		{
+			l.lastUsed = textCacheClock;
+			return l;
+		}
+	}
+
+	//miss: take a free slot, or evict the least recently drawn string
+	PROFILE_SCOPE("TTF text layout");
+	TextLayout* layout = NULL;
+	if (textCache.size() < TEXT_CACHE_SIZE)
+	{
+		textCache.push_back(TextLayout());
+		layout = &textCache.back();
+	}
+	else
+	{
+		layout = &textCache[0];
+		for (TextLayout& l : textCache)
+		{
+			if (l.lastUsed < layout->lastUsed)
+			{
+				layout = &l;
+			}
+		}
+	}
+
+	GlyphAtlas& atlas = glyphAtlases[atlasIndex];
+	layout->text = p_text;
+	layout->atlas = atlasIndex;
+	layout->lastUsed = textCacheClock;
+	layout->vertices.clear();
+	layout->indices.clear();
+	layout->w = 0;
+	layout->h = 0;
+	TTF_SizeText(font, p_text, &layout->w, &layout->h);
+
+	int texW = 1;
+	int texH = 1;
+	SDL_QueryTexture(atlas.tex, NULL, NULL, &texW, &texH);
+
+	int penX = 0;
+	Uint16 previous = 0;
+	for (const char* c = p_text; *c != '\0'; c++)
+	{
+		Uint16 ch = (unsigned char)*c;
+		if (ch < FIRST_GLYPH || ch >= FIRST_GLYPH + GLYPH_COUNT)
+		{
+			ch = '?';
+		}
+		if (previous != 0)
+		{
+			penX += TTF_GetFontKerningSizeGlyphs(font, previous, ch);
+		}
+		previous = ch;
+
+		SDL_Rect& g = atlas.glyphs[ch - FIRST_GLYPH];
+		if (g.w > 0)
+		{
+			int first = layout->vertices.size();
+			float u0 = (float)g.x/texW;
+			float v0 = (float)g.y/texH;
+			float u1 = (float)(g.x + g.w)/texW;
+			float v1 = (float)(g.y + g.h)/texH;
+			SDL_Vertex v;
+			v.color.r = 255;
+			v.color.g = 255;
+			v.color.b = 255;
+			v.color.a = 255;
+
+			v.position.x = penX;
+			v.position.y = 0;
+			v.tex_coord.x = u0;
+			v.tex_coord.y = v0;
+			layout->vertices.push_back(v);
+			v.position.x = penX + g.w;
+			v.tex_coord.x = u1;
+			layout->vertices.push_back(v);
+			v.position.y = g.h;
+			v.tex_coord.y = v1;
+			layout->vertices.push_back(v);
+			v.position.x = penX;
+			v.tex_coord.x = u0;
+			layout->vertices.push_back(v);
+
+			layout->indices.push_back(first);
+			layout->indices.push_back(first + 1);
+			layout->indices.push_back(first + 2);
+			layout->indices.push_back(first);
+			layout->indices.push_back(first + 2);
+			layout->indices.push_back(first + 3);
+		}
+		penX += atlas.advances[ch - FIRST_GLYPH];
+	}
+
+	return *layout;
+}
+
+void RenderWindow::renderText(float p_x, float p_y, TextLayout& p_layout)
+{
+	if (p_layout.indices.empty())
+	{
+		return;
+	}
+	flushBatch();
+
+	textVertices.resize(p_layout.vertices.size());
+	for (unsigned int i = 0; i < p_layout.vertices.size(); i++)
+	{
+		textVertices[i] = p_layout.vertices[i];
+		textVertices[i].position.x += p_x;
+		textVertices[i].position.y += p_y;
+	}
 
-		SDL_RenderCopy(renderer, message, &src, &dst);
-		SDL_FreeSurface(surfaceMessage);
-	 	SDL_DestroyTexture(message);
+	SDL_RenderGeometry(renderer, glyphAtlases[p_layout.atlas].tex, textVertices.data(), textVertices.size(), p_layout.indices.data(), p_layout.indices.size());
+}
+
+void RenderWindow::render(float p_x, float p_y, const char* p_text, TTF_Font* font, SDL_Color textColor)
+{
+	TextLayout& layout = getTextLayout(p_text, font, textColor);
+	renderText((int)p_x, (int)p_y, layout);
 }
 
 void RenderWindow::renderCenter(float p_x, float p_y, const char* p_text, TTF_Font* font, SDL_Color textColor)
 {
-		SDL_Surface* surfaceMessage = TTF_RenderText_Blended( font, p_text, textColor);
-		SDL_Texture* message = SDL_CreateTextureFromSurface(renderer, surfaceMessage);
+	TextLayout& layout = getTextLayout(p_text, font, textColor);
+	renderText((int)(640/2 - layout.w/2 + p_x), (int)(480/2 - layout.h/2 + p_y), layout);
+}
 
-		SDL_Rect src;
-		src.x = 0;
-		src.y = 0;
-		src.w = surfaceMessage->w;
-		src.h = surfaceMessage->h; 
+//an opaque texture the size of the window, for drawing that is kept across frames
+SDL_Texture* RenderWindow::createLayer()
+{
+	int w = 0;
+	int h = 0;
+	if (!SDL_RenderTargetSupported(renderer) || SDL_GetRendererOutputSize(renderer, &w, &h) != 0)
+	{
+		return NULL;
+	}
+	SDL_Texture* layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+	if (layer == NULL)
+	{
+		std::cout << "Failed to create layer. Error: " << SDL_GetError() << std::endl;
+		return NULL;
+	}
+	SDL_SetTextureBlendMode(layer, SDL_BLENDMODE_NONE);
+	return layer;
+}
 
-		SDL_Rect dst;
-		dst.x = 640/2 - src.w/2 + p_x;
-		dst.y = 480/2 - src.h/2 + p_y;
-		dst.w = src.w;
-		dst.h = src.h;
+//everything drawn until endLayer() goes into p_layer instead of the window
+void RenderWindow::beginLayer(SDL_Texture* p_layer)
+{
+	flushBatch();
+	SDL_SetRenderTarget(renderer, p_layer);
+	SDL_RenderClear(renderer);
+}
 
-		SDL_RenderCopy(renderer, message, &src, &dst);
-		SDL_FreeSurface(surfaceMessage);
-		SDL_DestroyTexture(message);
+void RenderWindow::endLayer()
+{
+	flushBatch();
+	SDL_SetRenderTarget(renderer, NULL);
+}
+
+void RenderWindow::renderLayer(SDL_Texture* p_layer)
+{
+	flushBatch();
+	SDL_RenderCopy(renderer, p_layer, NULL, NULL);
 }
 
 void RenderWindow::display()
 {
+	flushBatch();
+	PROFILE_SCOPE("RenderPresent");
 	SDL_RenderPresent(renderer);
 }
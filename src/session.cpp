@@ -0,0 +1,203 @@
+#include "Session.h"
+#include "Ball.h"
+#include "LevelPack.h"
+#include "Simulation.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+Session::Session(const LevelPack* p_pack)
+	:pack(p_pack)
+{}
+
+//every ball is a copy of p_ball, only told apart by its index
+void Session::setCourseCount(int p_count, const Ball& p_ball)
+{
+	balls.assign(p_count, p_ball);
+	courses.resize(p_count);
+	for (int i = 0; i < p_count; i++)
+	{
+		balls[i].getState().index = i;
+	}
+	//events pile up over a whole frame of ticks before the game plays them
+	events.reserve(p_count*MAX_EVENTS_PER_STEP*MAX_SIM_STEPS_PER_FRAME);
+	courseEvents.resize(p_count);
+	for (std::vector<SimEvent>& e : courseEvents)
+	{
+		e.clear();
+		e.reserve(MAX_EVENTS_PER_STEP);
+	}
+	//level data stays in the pack, only the world's packed copy is sized per level
+	int cellTileCount = 0;
+	for (int i = 0; i < pack->getLevelCount(); i++)
+	{
+		CollisionGrid grid = pack->getGrid(pack->getLevel(i));
+		if (grid.boxCount > 0 && grid.cellStart[grid.cols*grid.rows] > cellTileCount)
+		{
+			cellTileCount = grid.cellStart[grid.cols*grid.rows];
+		}
+	}
+	world.reserve(cellTileCount);
+}
+
+//resets the balls onto the courses of p_level, false once there are no levels left
+bool Session::loadLevel(int p_level)
+{
+	level = p_level;
+	events.clear();
+	if (level >= pack->getLevelCount())
+	{
+		finished = true;
+		return false;
+	}
+	const PackLevel& data = pack->getLevel(level);
+	const PackCourse* levelCourses = pack->getCourses(data);
+	if (data.courseCount == 0)
+	{
+		std::cout << "Level " << level << " has no courses" << std::endl;
+		//a finished session is always one past the last level, peers check for it
+		level = pack->getLevelCount();
+		finished = true;
+		return false;
+	}
+
+	world.view(pack->getGrid(data));
+	levelCourseCount = data.courseCount;
+	for (unsigned int i = 0; i < balls.size(); i++)
+	{
+		const PackCourse& c = levelCourses[i % data.courseCount];
+		Course& course = courses[i];
+		course.bounds.x = c.boundsX;
+		course.bounds.y = c.boundsY;
+		course.bounds.w = c.boundsW;
+		course.bounds.h = c.boundsH;
+		course.spawn = Vector2f(c.spawnX, c.spawnY);
+		course.hole = Vector2f(c.holeX, c.holeY);
+		balls[i].reset(course.spawn);
+	}
+	finished = false;
+	return true;
+}
+
+//one SIM_STEP_MS tick of every ball, true when it moved on to another level
+bool Session::step(const ShotInput& p_input)
+{
+	for (unsigned int i = 0; i < balls.size(); i++)
+	{
+		stepCourse(i, p_input);
+	}
+	return endStep();
+}
+
+void Session::stepCourse(int p_course, const ShotInput& p_input)
+{
+	if (finished)
+	{
+		return;
+	}
+	balls[p_course].update(p_input, world, courses[p_course], courseEvents[p_course]);
+}
+
+void Session::stepCourses(void* p_step, int p_begin, int p_end)
+{
+	SessionStep* step = (SessionStep*)p_step;
+	for (int i = p_begin; i < p_end; i++)
+	{
+		step->session->stepCourse(i, *step->input);
+	}
+}
+
+//merges the tick's events in course order, true when it moved on to another level
+bool Session::endStep()
+{
+	if (finished)
+	{
+		return false;
+	}
+	for (std::vector<SimEvent>& e : courseEvents)
+	{
+		events.insert(events.end(), e.begin(), e.end());
+		e.clear();
+	}
+	for (Ball& b : balls)
+	{
+		if (b.getState().scale.x >= -1)
+		{
+			return false;
+		}
+	}
+	loadLevel(level + 1);
+	return true;
+}
+
+static uint64_t hashBytes(uint64_t p_hash, const void* p_data, size_t p_size)
+{
+	const unsigned char* bytes = (const unsigned char*)p_data;
+	for (size_t i = 0; i < p_size; i++)
+	{
+		p_hash ^= bytes[i];
+		p_hash *= 1099511628211ull;
+	}
+	return p_hash;
+}
+
+static uint64_t hashInt(uint64_t p_hash, int32_t p_value)
+{
+	return hashBytes(p_hash, &p_value, sizeof(p_value));
+}
+
+//FNV-1a over every field that feeds the next tick, so two runs only agree if
+//they went through exactly the same states
+uint64_t Session::hash() const
+{
+	uint64_t h = 14695981039346656037ull;
+	h = hashInt(h, level);
+	h = hashInt(h, finished);
+	for (const Ball& ball : balls)
+	{
+		uint32_t words[BALL_STATE_WORDS];
+		packBallState(ball.getState(), words);
+		h = hashBytes(h, words, sizeof(words));
+	}
+	return h;
+}
+
+void Session::save(SessionState& p_state) const
+{
+	p_state.level = level;
+	p_state.finished = finished;
+	p_state.balls.resize(balls.size());
+	for (unsigned int i = 0; i < balls.size(); i++)
+	{
+		p_state.balls[i] = balls[i].getState();
+	}
+}
+
+//rewinds to a saved tick, switching level first if it was on another one
+void Session::restore(const SessionState& p_state)
+{
+	if (p_state.level != level || p_state.finished != finished)
+	{
+		loadLevel(p_state.level);
+	}
+	finished = p_state.finished;
+	events.clear();
+	for (unsigned int i = 0; i < balls.size() && i < p_state.balls.size(); i++)
+	{
+		balls[i].setState(p_state.balls[i]);
+	}
+}
+
+void Session::getSpawnState(int p_level, int p_course, BallState& p_ball) const
+{
+	p_ball = BallState();
+	p_ball.index = p_course;
+	if (p_level < pack->getLevelCount() && pack->getLevel(p_level).courseCount > 0)
+	{
+		const PackLevel& data = pack->getLevel(p_level);
+		const PackCourse& c = pack->getCourses(data)[p_course % data.courseCount];
+		resetBall(p_ball, Vector2f(c.spawnX, c.spawnY));
+	}
+}
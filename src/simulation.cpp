@@ -0,0 +1,238 @@
+#include "Simulation.h"
+#include "CollisionWorld.h"
+#include "Math.h"
+
+#include <string.h>
+#include <vector>
+#include <cmath>
+
+const float friction = 0.001;
+//gap left between the ball and a tile it bounced off, so the next sweep starts outside it
+const float CONTACT_SKIN = 0.001;
+
+static void pushEvent(std::vector<SimEvent>& p_events, SimEventType p_type, const BallState& p_ball)
+{
+	SimEvent e;
+	e.type = p_type;
+	e.ball = p_ball.index;
+	e.pos = p_ball.pos;
+	p_events.push_back(e);
+}
+
+static void moveBall(BallState& b, double deltaTime, const CollisionWorld& p_world, std::vector<SimEvent>& p_events)
+{
+	float remaining = 1;
+	for (int i = 0; i < MAX_BOUNCES_PER_STEP && remaining > 0; i++)
+	{
+		Vector2f delta(b.velocity.x*deltaTime*remaining, b.velocity.y*deltaTime*remaining);
+		SweepHit hit;
+		if (!p_world.sweep(b.pos, Vector2f(BALL_SIZE, BALL_SIZE), delta, hit))
+		{
+			b.pos.x += delta.x;
+			b.pos.y += delta.y;
+			return;
+		}
+
+		b.pos.x += delta.x*hit.time;
+		b.pos.y += delta.y*hit.time;
+		if (hit.axis == 0)
+		{
+			b.pos.x -= delta.x > 0 ? CONTACT_SKIN : -CONTACT_SKIN;
+			b.velocity.x *= -1;
+			b.dirX *= -1;
+		}
+		else
+		{
+			b.pos.y -= delta.y > 0 ? CONTACT_SKIN : -CONTACT_SKIN;
+			b.velocity.y *= -1;
+			b.dirY *= -1;
+		}
+		pushEvent(p_events, SIM_EVENT_BOUNCE, b);
+		remaining *= 1 - hit.time;
+	}
+}
+
+void packBallState(const BallState& p_ball, uint32_t* p_words)
+{
+	const BallState& b = p_ball;
+	const float floats[] = {b.pos.x, b.pos.y, b.scale.x, b.scale.y, b.velocity.x, b.velocity.y, b.target.x, b.target.y,
+		b.launchedVelocity.x, b.launchedVelocity.y, b.velocity1D, b.launchedVelocity1D, b.initialMousePos.x, b.initialMousePos.y};
+	const int32_t ints[] = {b.canMove, b.aiming, b.playedSwingFx, b.index, b.strokes, b.dirX, b.dirY, b.win};
+	memcpy(p_words, floats, sizeof(floats));
+	memcpy(p_words + 14, ints, sizeof(ints));
+}
+
+void unpackBallState(const uint32_t* p_words, BallState& p_ball)
+{
+	float floats[14];
+	int32_t ints[8];
+	memcpy(floats, p_words, sizeof(floats));
+	memcpy(ints, p_words + 14, sizeof(ints));
+	BallState& b = p_ball;
+	b.pos = Vector2f(floats[0], floats[1]);
+	b.scale = Vector2f(floats[2], floats[3]);
+	b.velocity = Vector2f(floats[4], floats[5]);
+	b.target = Vector2f(floats[6], floats[7]);
+	b.launchedVelocity = Vector2f(floats[8], floats[9]);
+	b.velocity1D = floats[10];
+	b.launchedVelocity1D = floats[11];
+	b.initialMousePos = Vector2f(floats[12], floats[13]);
+	b.canMove = ints[0] != 0;
+	b.aiming = ints[1] != 0;
+	b.playedSwingFx = ints[2] != 0;
+	b.index = ints[3];
+	b.strokes = ints[4];
+	b.dirX = ints[5];
+	b.dirY = ints[6];
+	b.win = ints[7] != 0;
+}
+
+void aimBall(BallState& p_ball, Vector2f p_drag)
+{
+	BallState& b = p_ball;
+	b.aiming = true;
+	b.velocity.x = p_drag.x/-150;
+	b.velocity.y = p_drag.y/-150;
+	b.launchedVelocity = b.velocity;
+	b.velocity1D = std::sqrt(b.velocity.x*b.velocity.x + b.velocity.y*b.velocity.y);
+	b.launchedVelocity1D = b.velocity1D;
+
+	b.dirX = b.velocity.x < 0 ? -1 : 1;
+	b.dirY = b.velocity.y < 0 ? -1 : 1;
+
+	if (b.velocity1D > 1)
+	{
+		b.velocity1D = 1;
+		b.launchedVelocity1D = 1;
+	}
+}
+
+void resetBall(BallState& p_ball, Vector2f p_pos)
+{
+	p_ball.pos = p_pos;
+	p_ball.velocity = Vector2f(0, 0);
+	p_ball.scale = Vector2f(1, 1);
+	p_ball.win = false;
+}
+
+void stepBall(BallState& p_ball, double deltaTime, const ShotInput& p_input, const CollisionWorld& p_world, const Course& p_course, std::vector<SimEvent>& p_events)
+{
+	BallState& b = p_ball;
+	if (b.win)
+	{
+		if (b.pos.x < b.target.x)
+		{
+			b.pos.x += 0.1*deltaTime;
+		}
+		else if (b.pos.x > b.target.x)
+		{
+			b.pos.x -= 0.1*deltaTime;
+		}
+		if (b.pos.y < b.target.y)
+		{
+			b.pos.y += 0.1*deltaTime;
+		}
+		else if (b.pos.y > b.target.y)
+		{
+			b.pos.y -= 0.1*deltaTime;
+		}
+		b.scale.x -= 0.001*deltaTime;
+		b.scale.y -= 0.001*deltaTime;
+		return;
+	}
+
+	const Vector2f& h = p_course.hole;
+	if (b.pos.x + 4 > h.x && b.pos.x + 16 < h.x + 20 && b.pos.y + 4 > h.y && b.pos.y + 16 < h.y + 20)
+	{
+		pushEvent(p_events, SIM_EVENT_HOLE, b);
+		b.win = true;
+		b.target.x = h.x;
+		b.target.y = h.y + 3;
+	}
+
+	if (p_input.mousePressed && b.canMove)
+	{
+		pushEvent(p_events, SIM_EVENT_CHARGE, b);
+		b.playedSwingFx = false;
+		b.initialMousePos = p_input.mousePos;
+	}
+	if (p_input.mouseDown && b.canMove)
+	{
+		aimBall(b, Vector2f(p_input.mousePos.x - b.initialMousePos.x, p_input.mousePos.y - b.initialMousePos.y));
+	}
+	else
+	{
+		b.aiming = false;
+		if (!b.playedSwingFx)
+		{
+			pushEvent(p_events, SIM_EVENT_SWING, b);
+			b.playedSwingFx = true;
+			b.strokes++;
+		}
+		b.canMove = false;
+		moveBall(b, deltaTime, p_world, p_events);
+		if (b.velocity.x > 0.0001 || b.velocity.x < -0.0001 || b.velocity.y > 0.0001 || b.velocity.y < -0.0001)
+		{
+			if (b.velocity1D > 0)
+			{
+				b.velocity1D -= friction*deltaTime;
+			}
+			else
+			{
+				b.velocity1D = 0;
+			}
+			b.velocity.x = (b.velocity1D/b.launchedVelocity1D)*std::fabs(b.launchedVelocity.x)*b.dirX;
+			b.velocity.y = (b.velocity1D/b.launchedVelocity1D)*std::fabs(b.launchedVelocity.y)*b.dirY;
+		}
+		else
+		{
+			b.velocity = Vector2f(0, 0);
+			b.initialMousePos = p_input.mousePos;
+			b.canMove = true;
+		}
+
+		//a ball past a bound is put back inside it, and only bounces while it is
+		//still heading out; one that stopped there would bounce every tick
+		const SimRect& bounds = p_course.bounds;
+		if (b.pos.x + BALL_SIZE > bounds.x + bounds.w)
+		{
+			b.pos.x = bounds.x + bounds.w - BALL_SIZE;
+			if (b.velocity.x > 0)
+			{
+				b.velocity.x = -b.velocity.x;
+				b.dirX = -1;
+				pushEvent(p_events, SIM_EVENT_BOUNCE, b);
+			}
+		}
+		else if (b.pos.x < bounds.x)
+		{
+			b.pos.x = bounds.x;
+			if (b.velocity.x < 0)
+			{
+				b.velocity.x = -b.velocity.x;
+				b.dirX = 1;
+				pushEvent(p_events, SIM_EVENT_BOUNCE, b);
+			}
+		}
+		else if (b.pos.y + BALL_SIZE > bounds.y + bounds.h)
+		{
+			b.pos.y = bounds.y + bounds.h - BALL_SIZE;
+			if (b.velocity.y > 0)
+			{
+				b.velocity.y = -b.velocity.y;
+				b.dirY = -1;
+				pushEvent(p_events, SIM_EVENT_BOUNCE, b);
+			}
+		}
+		else if (b.pos.y < bounds.y)
+		{
+			b.pos.y = bounds.y;
+			if (b.velocity.y < 0)
+			{
+				b.velocity.y = -b.velocity.y;
+				b.dirY = 1;
+				pushEvent(p_events, SIM_EVENT_BOUNCE, b);
+			}
+		}
+	}
+}
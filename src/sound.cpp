@@ -0,0 +1,290 @@
+#include "Sound.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <string>
+#include <cstring>
+
+const char SOUND_CACHE_MAGIC[4] = {'T', 'G', 'S', 'C'};
+const Uint32 SOUND_CACHE_VERSION = 2;
+
+struct SoundCacheHeader
+{
+	char magic[4];
+	Uint32 version;
+	Sint32 frequency;
+	Uint32 format;
+	Sint32 channels;
+	//size and FNV-1a hash of the compressed file it came from
+	Uint32 sourceSize;
+	Uint64 sourceHash;
+	Uint32 length;
+};
+
+//the compressed files are small, hashing one costs far less than decoding it
+static bool hashFile(const char* p_filePath, Uint32& p_size, Uint64& p_hash)
+{
+	SDL_RWops* file = SDL_RWFromFile(p_filePath, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	p_size = 0;
+	p_hash = 14695981039346656037ULL;
+	unsigned char buffer[4096];
+	size_t read;
+	while ((read = SDL_RWread(file, buffer, 1, sizeof(buffer))) > 0)
+	{
+		for (size_t i = 0; i < read; i++)
+		{
+			p_hash = (p_hash ^ buffer[i])*1099511628211ULL;
+		}
+		p_size += read;
+	}
+	SDL_RWclose(file);
+	return true;
+}
+
+static std::string getCachePath(const char* p_filePath, const char* p_cacheDir)
+{
+	std::string name = p_filePath;
+	for (char& c : name)
+	{
+		if (c == '/' || c == '\\' || c == '.' || c == ':')
+		{
+			c = '_';
+		}
+	}
+	return std::string(p_cacheDir) + name + ".pcm";
+}
+
+static Mix_Chunk* readCache(const std::string& p_cachePath, const SoundCacheHeader& p_expected)
+{
+	SDL_RWops* file = SDL_RWFromFile(p_cachePath.c_str(), "rb");
+	if (file == NULL)
+	{
+		return NULL;
+	}
+
+	SoundCacheHeader header;
+	Mix_Chunk* chunk = NULL;
+	if (SDL_RWread(file, &header, sizeof(header), 1) == 1 && std::memcmp(header.magic, p_expected.magic, 4) == 0 && header.version == p_expected.version
+		&& header.frequency == p_expected.frequency && header.format == p_expected.format && header.channels == p_expected.channels
+		&& header.sourceSize == p_expected.sourceSize && header.sourceHash == p_expected.sourceHash && header.length > 0)
+	{
+		Uint8* pcm = (Uint8*)SDL_malloc(header.length);
+		if (pcm != NULL && SDL_RWread(file, pcm, header.length, 1) == 1)
+		{
+			chunk = Mix_QuickLoad_RAW(pcm, header.length);
+		}
+		if (chunk != NULL)
+		{
+			//let Mix_FreeChunk release the buffer along with the chunk
+			chunk->allocated = 1;
+		}
+		else
+		{
+			SDL_free(pcm);
+		}
+	}
+	SDL_RWclose(file);
+	return chunk;
+}
+
+static void writeCache(const std::string& p_cachePath, SoundCacheHeader p_header, Mix_Chunk* p_chunk)
+{
+	SDL_RWops* file = SDL_RWFromFile(p_cachePath.c_str(), "wb");
+	if (file == NULL)
+	{
+		return;
+	}
+	p_header.length = p_chunk->alen;
+	SDL_RWwrite(file, &p_header, sizeof(p_header), 1);
+	SDL_RWwrite(file, p_chunk->abuf, p_chunk->alen, 1);
+	SDL_RWclose(file);
+}
+
+Mix_Chunk* loadSound(const char* p_filePath, const char* p_cacheDir)
+{
+	SoundCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SOUND_CACHE_MAGIC, 4);
+	header.version = SOUND_CACHE_VERSION;
+
+	Uint16 format = 0;
+	int frequency = 0;
+	int channels = 0;
+	if (p_cacheDir == NULL || Mix_QuerySpec(&frequency, &format, &channels) == 0)
+	{
+		return Mix_LoadWAV(p_filePath);
+	}
+	header.frequency = frequency;
+	header.format = format;
+	header.channels = channels;
+
+	hashFile(p_filePath, header.sourceSize, header.sourceHash);
+
+	std::string cachePath = getCachePath(p_filePath, p_cacheDir);
+	Mix_Chunk* chunk = readCache(cachePath, header);
+	if (chunk != NULL)
+	{
+		return chunk;
+	}
+
+	chunk = Mix_LoadWAV(p_filePath);
+	if (chunk != NULL)
+	{
+		writeCache(cachePath, header, chunk);
+	}
+	return chunk;
+}
+
+void SoundQueue::play(int p_sound, int p_course, float p_x)
+{
+	SoundRequest& request = pending[p_sound];
+	if (pendingCount[p_sound] == 0)
+	{
+		request.sound = p_sound;
+		request.course = p_course;
+		request.x = 0;
+	}
+	else if (request.course != p_course)
+	{
+		request.course = -1;
+	}
+	request.x += p_x;
+	pendingCount[p_sound]++;
+}
+
+void SoundQueue::send()
+{
+	//the hole-out first, it matters most
+	for (int i = SOUND_COUNT - 1; i >= 0; i--)
+	{
+		if (pendingCount[i] == 0)
+		{
+			continue;
+		}
+		SoundRequest request = pending[i];
+		request.x /= pendingCount[i];
+		pendingCount[i] = 0;
+		//a full queue means far more at once than there are voices to play
+		//them, only a hole-out is kept for later
+		if (!requests.push(request) && i == SOUND_HOLE)
+		{
+			holeDropped.store(true, std::memory_order_release);
+		}
+	}
+}
+
+bool SoundQueue::pop(SoundRequest& p_request)
+{
+	if (requests.pop(p_request))
+	{
+		return true;
+	}
+	if (holeDropped.exchange(false, std::memory_order_acquire))
+	{
+		p_request.sound = SOUND_HOLE;
+		p_request.course = -1;
+		p_request.x = 0;
+		return true;
+	}
+	return false;
+}
+
+void VoiceManager::open(const SoundSettings* p_settings)
+{
+	for (int i = 0; i < SOUND_COUNT; i++)
+	{
+		settings[i] = p_settings[i];
+	}
+	voiceCount = SDL_min(VOICE_COUNT, Mix_AllocateChannels(VOICE_COUNT));
+}
+
+//lower priority first, then quieter, then older
+static bool isBetterVictim(int p_priority, int p_loudness, Uint32 p_started, int p_otherPriority, int p_otherLoudness, Uint32 p_otherStarted)
+{
+	if (p_priority != p_otherPriority)
+	{
+		return p_priority < p_otherPriority;
+	}
+	if (p_loudness != p_otherLoudness)
+	{
+		return p_loudness < p_otherLoudness;
+	}
+	return p_started < p_otherStarted;
+}
+
+bool VoiceManager::play(Mix_Chunk* p_chunk, int p_sound, float p_pan)
+{
+	if (p_chunk == NULL)
+	{
+		return false;
+	}
+	const SoundSettings& sound = settings[p_sound];
+	int loudness = sound.volume*p_chunk->volume;
+	int instances = 0;
+	int oldestInstance = -1;
+	int freeVoice = -1;
+	int victim = -1;
+	for (int i = 0; i < voiceCount; i++)
+	{
+		Voice& v = voices[i];
+		if (v.sound != -1 && !Mix_Playing(i))
+		{
+			v.sound = -1;
+		}
+		if (v.sound == -1)
+		{
+			if (freeVoice == -1)
+			{
+				freeVoice = i;
+			}
+			continue;
+		}
+		if (v.sound == p_sound)
+		{
+			instances++;
+			if (oldestInstance == -1 || v.started < voices[oldestInstance].started)
+			{
+				oldestInstance = i;
+			}
+		}
+		if (v.priority <= sound.priority && (victim == -1
+			|| isBetterVictim(v.priority, v.loudness, v.started, voices[victim].priority, voices[victim].loudness, voices[victim].started)))
+		{
+			victim = i;
+		}
+	}
+	int channel = victim;
+	if (instances >= sound.maxInstances)
+	{
+		channel = oldestInstance;
+	}
+	else if (freeVoice != -1)
+	{
+		channel = freeVoice;
+	}
+	if (channel == -1)
+	{
+		return false;
+	}
+
+	//full volume on the near side, fading out on the far one; centred is
+	//255 on both, which takes the panning effect off the channel entirely
+	p_pan = SDL_max(0.0f, SDL_min(1.0f, p_pan));
+	Mix_SetPanning(channel, 255*SDL_min(1.0f, 2 - 2*p_pan), 255*SDL_min(1.0f, 2*p_pan));
+	Mix_Volume(channel, sound.volume);
+	Voice& v = voices[channel];
+	if (Mix_PlayChannel(channel, p_chunk, 0) == -1)
+	{
+		v.sound = -1;
+		return false;
+	}
+	v.sound = p_sound;
+	v.priority = sound.priority;
+	v.loudness = loudness;
+	v.started = playCount++;
+	return true;
+}
@@ -0,0 +1,533 @@
+#include "StateHistory.h"
+#include "InputLog.h"
+#include "Session.h"
+#include "Simulation.h"
+
+#include <stdint.h>
+#include <vector>
+
+//level and finished come before the balls' words
+const int STATE_HEADER_WORDS = 2;
+//an entry's first byte is its tick within the segment, so a segment must fit in one
+const uint8_t HISTORY_STROKE = 0x80;
+//the input in effect when a segment starts, flags and position
+const uint32_t SEGMENT_HEADER_BYTES = 5;
+//a changed word is its leading zero count, its length and its significant bits
+const int WORD_BITS = 1 + 5 + 5 + 32;
+
+struct BitWriter
+{
+	std::vector<uint8_t>& bytes;
+	uint32_t& pos;
+	uint64_t bits;
+	int count;
+};
+
+struct BitReader
+{
+	const std::vector<uint8_t>& bytes;
+	uint32_t& pos;
+	uint64_t bits;
+	int count;
+};
+
+static void putBits(BitWriter& p_writer, uint32_t p_value, int p_count)
+{
+	p_writer.bits |= (uint64_t)p_value << p_writer.count;
+	p_writer.count += p_count;
+	while (p_writer.count >= 8)
+	{
+		p_writer.bytes[p_writer.pos++ % p_writer.bytes.size()] = p_writer.bits;
+		p_writer.bits >>= 8;
+		p_writer.count -= 8;
+	}
+}
+
+static void flushBits(BitWriter& p_writer)
+{
+	if (p_writer.count > 0)
+	{
+		putBits(p_writer, 0, 8 - p_writer.count);
+	}
+}
+
+static uint32_t getBits(BitReader& p_reader, int p_count)
+{
+	while (p_reader.count < p_count)
+	{
+		p_reader.bits |= (uint64_t)p_reader.bytes[p_reader.pos++ % p_reader.bytes.size()] << p_reader.count;
+		p_reader.count += 8;
+	}
+	uint32_t value = p_reader.bits & ((1ull << p_count) - 1);
+	p_reader.bits >>= p_count;
+	p_reader.count -= p_count;
+	return value;
+}
+
+//a float that barely moved only differs from its old self in the low
+//mantissa bits, so the XOR of the two is mostly leading and trailing zeros
+static void putWord(BitWriter& p_writer, uint32_t p_delta)
+{
+	if (p_delta == 0)
+	{
+		putBits(p_writer, 0, 1);
+		return;
+	}
+	int leading = __builtin_clz(p_delta);
+	int trailing = __builtin_ctz(p_delta);
+	int length = 32 - leading - trailing;
+	putBits(p_writer, 1, 1);
+	putBits(p_writer, leading, 5);
+	putBits(p_writer, length - 1, 5);
+	putBits(p_writer, p_delta >> trailing, length);
+}
+
+static uint32_t getWord(BitReader& p_reader)
+{
+	if (getBits(p_reader, 1) == 0)
+	{
+		return 0;
+	}
+	int leading = getBits(p_reader, 5);
+	int length = getBits(p_reader, 5) + 1;
+	return getBits(p_reader, length) << (32 - leading - length);
+}
+
+void StateHistory::reset(const Session& p_session)
+{
+	session = &p_session;
+	int wordCount = STATE_HEADER_WORDS + p_session.getCourseCount()*BALL_STATE_WORDS;
+	keyWords.assign(wordCount, 0);
+	lastWords.assign(wordCount, 0);
+	words.assign(wordCount, 0);
+	baseWords.assign(wordCount, 0);
+	state.balls.resize(p_session.getCourseCount());
+	maxStateBytes = (wordCount*WORD_BITS + p_session.getCourseCount() + 7)/8;
+	//a segment's state and a stroke or two have to fit many times over
+	uint32_t size = HISTORY_BYTES > 16*maxStateBytes ? HISTORY_BYTES : 16*maxStateBytes;
+	bytes.assign(size, 0);
+
+	writePos = 0;
+	firstSegment = 0;
+	segmentCount = 0;
+	firstStroke = 0;
+	strokeCount = 0;
+	playhead = 0;
+	endTick = 0;
+	lastInput = ShotInput();
+	lastInput.mouseDown = false;
+	lastInput.mousePressed = false;
+	inputDirty = true;
+	hasKey = false;
+}
+
+//drops the oldest segments until p_bytes more fit in the ring
+void StateHistory::reserve(uint32_t p_bytes)
+{
+	while (segmentCount > 1 && writePos + p_bytes - getSegment(firstSegment).start > bytes.size())
+	{
+		firstSegment++;
+		segmentCount--;
+	}
+}
+
+bool StateHistory::isHeld(uint32_t p_pos) const
+{
+	return segmentCount > 0 && p_pos >= getSegment(firstSegment).start && p_pos < writePos;
+}
+
+int StateHistory::getOldestTick() const
+{
+	for (int i = firstSegment; i < firstSegment + segmentCount; i++)
+	{
+		const HistorySegment& segment = getSegment(i);
+		if (isHeld(segment.statePos) && isHeld(segment.keyPos))
+		{
+			return i*HISTORY_SEGMENT_TICKS;
+		}
+	}
+	return endTick;
+}
+
+void StateHistory::writeByte(uint8_t p_byte)
+{
+	bytes[writePos++ % bytes.size()] = p_byte;
+}
+
+void StateHistory::writeInput(const ShotInput& p_input)
+{
+	int16_t x = p_input.mousePos.x;
+	int16_t y = p_input.mousePos.y;
+	writeByte((uint16_t)x);
+	writeByte((uint16_t)x >> 8);
+	writeByte((uint16_t)y);
+	writeByte((uint16_t)y >> 8);
+}
+
+//one bit for a ball that matches p_base throughout, otherwise every word
+uint32_t StateHistory::writeState(const std::vector<uint32_t>& p_words, const std::vector<uint32_t>& p_base)
+{
+	uint32_t start = writePos;
+	BitWriter writer = {bytes, writePos, 0, 0};
+	for (int i = 0; i < STATE_HEADER_WORDS; i++)
+	{
+		putWord(writer, p_words[i] ^ p_base[i]);
+	}
+	for (unsigned int first = STATE_HEADER_WORDS; first < p_words.size(); first += BALL_STATE_WORDS)
+	{
+		bool changed = false;
+		for (int i = 0; i < BALL_STATE_WORDS; i++)
+		{
+			changed = changed || p_words[first + i] != p_base[first + i];
+		}
+		putBits(writer, changed, 1);
+		for (int i = 0; changed && i < BALL_STATE_WORDS; i++)
+		{
+			putWord(writer, p_words[first + i] ^ p_base[first + i]);
+		}
+	}
+	flushBits(writer);
+	return start;
+}
+
+//XORs the state at p_pos onto p_words; a keyframe is XORed against its level's
+//spawn state, so p_words only needs to hold the header words being zero
+void StateHistory::readState(uint32_t& p_pos, std::vector<uint32_t>& p_words, bool p_key) const
+{
+	BitReader reader = {bytes, p_pos, 0, 0};
+	for (int i = 0; i < STATE_HEADER_WORDS; i++)
+	{
+		p_words[i] ^= getWord(reader);
+	}
+	if (p_key)
+	{
+		getSpawnWords(p_words[0], p_words);
+	}
+	for (unsigned int first = STATE_HEADER_WORDS; first < p_words.size(); first += BALL_STATE_WORDS)
+	{
+		if (getBits(reader, 1) == 0)
+		{
+			continue;
+		}
+		for (int i = 0; i < BALL_STATE_WORDS; i++)
+		{
+			p_words[first + i] ^= getWord(reader);
+		}
+	}
+	//the next thing written started on a fresh byte
+}
+
+//moves p_pos past a state without decoding it, a keyframe would need its
+//level's spawn state, which is only known once the header is decoded
+void StateHistory::skipState(uint32_t& p_pos) const
+{
+	BitReader reader = {bytes, p_pos, 0, 0};
+	for (int i = 0; i < STATE_HEADER_WORDS; i++)
+	{
+		getWord(reader);
+	}
+	for (unsigned int first = STATE_HEADER_WORDS; first < baseWords.size(); first += BALL_STATE_WORDS)
+	{
+		if (getBits(reader, 1) == 0)
+		{
+			continue;
+		}
+		for (int i = 0; i < BALL_STATE_WORDS; i++)
+		{
+			getWord(reader);
+		}
+	}
+}
+
+void StateHistory::readInput(uint32_t& p_pos, uint8_t p_flags, ShotInput& p_input) const
+{
+	p_input.mouseDown = (p_flags & INPUT_DOWN) != 0;
+	p_input.mousePressed = (p_flags & INPUT_PRESSED) != 0;
+	if (p_flags & INPUT_MOVED)
+	{
+		uint8_t b[4];
+		for (int i = 0; i < 4; i++)
+		{
+			b[i] = bytes[p_pos++ % bytes.size()];
+		}
+		p_input.mousePos.x = (int16_t)(b[0] | b[1] << 8);
+		p_input.mousePos.y = (int16_t)(b[2] | b[3] << 8);
+	}
+}
+
+//a keyframe and at most one delta, whatever tick it is
+bool StateHistory::decode(uint32_t p_statePos, uint32_t p_keyPos, std::vector<uint32_t>& p_words) const
+{
+	if (!isHeld(p_statePos) || !isHeld(p_keyPos))
+	{
+		return false;
+	}
+	p_words[0] = 0;
+	p_words[1] = 0;
+	uint32_t pos = p_keyPos;
+	readState(pos, p_words, true);
+	if (p_statePos != p_keyPos)
+	{
+		pos = p_statePos;
+		readState(pos, p_words, false);
+	}
+	return true;
+}
+
+void StateHistory::getWords(const Session& p_session, std::vector<uint32_t>& p_words) const
+{
+	p_words[0] = p_session.level;
+	p_words[1] = p_session.finished;
+	for (int i = 0; i < p_session.getCourseCount(); i++)
+	{
+		packBallState(p_session.balls[i].getState(), &p_words[STATE_HEADER_WORDS + i*BALL_STATE_WORDS]);
+	}
+}
+
+//the balls' part of p_words, as they are when p_level starts
+void StateHistory::getSpawnWords(int p_level, std::vector<uint32_t>& p_words) const
+{
+	for (int i = 0; i < session->getCourseCount(); i++)
+	{
+		BallState spawn;
+		session->getSpawnState(p_level, i, spawn);
+		packBallState(spawn, &p_words[STATE_HEADER_WORDS + i*BALL_STATE_WORDS]);
+	}
+}
+
+void StateHistory::restore(Session& p_session, const std::vector<uint32_t>& p_words)
+{
+	state.level = p_words[0];
+	state.finished = p_words[1] != 0;
+	for (unsigned int i = 0; i < state.balls.size(); i++)
+	{
+		unpackBallState(&p_words[STATE_HEADER_WORDS + i*BALL_STATE_WORDS], state.balls[i]);
+	}
+	p_session.restore(state);
+}
+
+void StateHistory::beginSegment(const Session& p_session)
+{
+	if (segmentCount == HISTORY_SEGMENTS)
+	{
+		firstSegment++;
+		segmentCount--;
+	}
+	reserve(SEGMENT_HEADER_BYTES + maxStateBytes);
+	HistorySegment segment;
+	segment.start = writePos;
+	writeByte((lastInput.mouseDown ? INPUT_DOWN : 0) | INPUT_MOVED);
+	writeInput(lastInput);
+
+	getWords(p_session, words);
+	const HistorySegment* previous = segmentCount > 0 ? &getSegment(firstSegment + segmentCount - 1) : NULL;
+	//a keyframe goes in before the last one is halfway to being overwritten
+	if (!hasKey || writePos - keyPos > bytes.size()/2)
+	{
+		baseWords[0] = 0;
+		baseWords[1] = 0;
+		getSpawnWords(words[0], baseWords);
+		keyPos = writeState(words, baseWords);
+		keyWords = words;
+		hasKey = true;
+		segment.statePos = keyPos;
+		segment.keyPos = keyPos;
+	}
+	else if (previous != NULL && words == lastWords && isHeld(previous->statePos) && isHeld(previous->keyPos))
+	{
+		segment.statePos = previous->statePos;
+		segment.keyPos = previous->keyPos;
+	}
+	else
+	{
+		segment.statePos = writeState(words, keyWords);
+		segment.keyPos = keyPos;
+	}
+	lastWords = words;
+	segments[(firstSegment + segmentCount) % HISTORY_SEGMENTS] = segment;
+	segmentCount++;
+}
+
+void StateHistory::record(const Session& p_session, const ShotInput& p_input)
+{
+	if (session == NULL)
+	{
+		return;
+	}
+	if (playhead < endTick)
+	{
+		truncate(playhead);
+	}
+	int offset = playhead % HISTORY_SEGMENT_TICKS;
+	if (offset == 0)
+	{
+		beginSegment(p_session);
+	}
+
+	//a press that will start aiming is where undo goes back to
+	bool stroke = false;
+	for (int i = 0; p_input.mousePressed && i < p_session.getCourseCount(); i++)
+	{
+		const BallState& b = p_session.balls[i].getState();
+		stroke = stroke || (b.canMove && !b.win);
+	}
+	if (stroke && !p_session.finished)
+	{
+		reserve(2 + maxStateBytes);
+		writeByte(offset);
+		writeByte(HISTORY_STROKE);
+		getWords(p_session, words);
+		baseWords[0] = 0;
+		baseWords[1] = 0;
+		getSpawnWords(words[0], baseWords);
+		keyPos = writeState(words, baseWords);
+		keyWords = words;
+		hasKey = true;
+		if (strokeCount == HISTORY_STROKES)
+		{
+			firstStroke++;
+			strokeCount--;
+		}
+		HistoryStroke& s = strokes[(firstStroke + strokeCount) % HISTORY_STROKES];
+		s.tick = playhead;
+		s.keyPos = keyPos;
+		strokeCount++;
+	}
+
+	//only changes are written, like an input log
+	bool moved = (int16_t)p_input.mousePos.x != (int16_t)lastInput.mousePos.x || (int16_t)p_input.mousePos.y != (int16_t)lastInput.mousePos.y;
+	if (inputDirty || moved || p_input.mousePressed || p_input.mouseDown != lastInput.mouseDown)
+	{
+		reserve(6);
+		writeByte(offset);
+		writeByte((p_input.mouseDown ? INPUT_DOWN : 0) | (p_input.mousePressed ? INPUT_PRESSED : 0) | (moved || inputDirty ? INPUT_MOVED : 0));
+		if (moved || inputDirty)
+		{
+			writeInput(p_input);
+		}
+	}
+	lastInput = p_input;
+	lastInput.mousePressed = false;
+	inputDirty = false;
+	playhead++;
+	endTick = playhead;
+}
+
+bool StateHistory::undo(Session& p_session)
+{
+	for (int i = strokeCount - 1; i >= 0; i--)
+	{
+		const HistoryStroke& s = strokes[(firstStroke + i) % HISTORY_STROKES];
+		if (s.tick >= playhead)
+		{
+			continue;
+		}
+		if (!decode(s.keyPos, s.keyPos, words))
+		{
+			return false;
+		}
+		restore(p_session, words);
+		playhead = s.tick;
+		return true;
+	}
+	return false;
+}
+
+bool StateHistory::seek(Session& p_session, int p_tick)
+{
+	if (session == NULL || segmentCount == 0)
+	{
+		return false;
+	}
+	int oldest = getOldestTick();
+	p_tick = p_tick < oldest ? oldest : p_tick > endTick ? endTick : p_tick;
+	int last = firstSegment + segmentCount - 1;
+	int index = p_tick/HISTORY_SEGMENT_TICKS < last ? p_tick/HISTORY_SEGMENT_TICKS : last;
+	const HistorySegment& segment = getSegment(index);
+	if (!decode(segment.statePos, segment.keyPos, words))
+	{
+		return false;
+	}
+	restore(p_session, words);
+
+	//run the segment's inputs up to the tick
+	uint32_t pos = segment.start;
+	ShotInput input;
+	readInput(++pos, bytes[segment.start % bytes.size()], input);
+	if (segment.statePos == pos)
+	{
+		skipState(pos);
+	}
+	uint32_t end = index == last ? writePos : getSegment(index + 1).start;
+	for (int tick = index*HISTORY_SEGMENT_TICKS; tick < p_tick; tick++)
+	{
+		input.mousePressed = false;
+		while (pos < end && bytes[pos % bytes.size()] == tick - index*HISTORY_SEGMENT_TICKS)
+		{
+			uint8_t flags = bytes[(pos + 1) % bytes.size()];
+			pos += 2;
+			if (flags & HISTORY_STROKE)
+			{
+				skipState(pos);
+			}
+			else
+			{
+				readInput(pos, flags, input);
+			}
+		}
+		p_session.step(input);
+		p_session.events.clear();
+	}
+	playhead = p_tick;
+	return true;
+}
+
+//forgets everything from p_tick on, record() carries on from there
+void StateHistory::truncate(int p_tick)
+{
+	int index = p_tick/HISTORY_SEGMENT_TICKS;
+	int last = firstSegment + segmentCount - 1;
+	if (index <= last)
+	{
+		const HistorySegment& segment = getSegment(index);
+		int offset = p_tick % HISTORY_SEGMENT_TICKS;
+		if (offset == 0)
+		{
+			writePos = segment.start;
+			segmentCount = index - firstSegment;
+		}
+		else
+		{
+			uint32_t pos = segment.start + SEGMENT_HEADER_BYTES;
+			if (segment.statePos == pos)
+			{
+				skipState(pos);
+			}
+			uint32_t end = index == last ? writePos : getSegment(index + 1).start;
+			while (pos < end && bytes[pos % bytes.size()] < offset)
+			{
+				uint8_t flags = bytes[(pos + 1) % bytes.size()];
+				pos += 2;
+				if (flags & HISTORY_STROKE)
+				{
+					skipState(pos);
+				}
+				else
+				{
+					ShotInput input;
+					readInput(pos, flags, input);
+				}
+			}
+			writePos = pos;
+			segmentCount = index - firstSegment + 1;
+		}
+	}
+	while (strokeCount > 0 && strokes[(firstStroke + strokeCount - 1) % HISTORY_STROKES].tick >= p_tick)
+	{
+		strokeCount--;
+	}
+	//what was keyed or said last may have gone with the dropped ticks
+	hasKey = false;
+	inputDirty = true;
+	endTick = p_tick;
+}
@@ -0,0 +1,209 @@
+#include "TileKernel.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define TILE_KERNEL_X86
+#include <immintrin.h>
+//only GCC and Clang can build one function for AVX2 in an SSE2 build, other
+//compilers get the SSE2 kernel at most
+#if defined(__GNUC__) || defined(__clang__)
+#define TILE_KERNEL_X86_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//Per axis, with the ball spanning [p_min, p_max] and moving by p_delta:
+//  delta > 0: entry = (boxMin - max)/delta, exit = (boxMax - min)/delta
+//  delta < 0: entry = (boxMax - min)/delta, exit = (boxMin - max)/delta
+//  delta = 0: always inside while the spans overlap, never otherwise
+//A box is hit when entry < exit, exit > 0 and entry >= -0.001 (already deeper
+//than rounding error means the ball started inside and may leave).
+const float MAX_START_DEPTH = -0.001f;
+
+static void sweepAxis(float p_min, float p_max, float p_delta, float p_boxMin, float p_boxMax, float& p_entry, float& p_exit)
+{
+	if (p_delta > 0)
+	{
+		p_entry = (p_boxMin - p_max)/p_delta;
+		p_exit = (p_boxMax - p_min)/p_delta;
+	}
+	else if (p_delta < 0)
+	{
+		p_entry = (p_boxMax - p_min)/p_delta;
+		p_exit = (p_boxMin - p_max)/p_delta;
+	}
+	else if (p_max > p_boxMin && p_min < p_boxMax)
+	{
+		p_entry = -INFINITY;
+		p_exit = INFINITY;
+	}
+	else
+	{
+		p_entry = INFINITY;
+		p_exit = -INFINITY;
+	}
+}
+
+static void sweepScalar(const TileSweep& p_sweep, const float* p_minX, const float* p_minY, const float* p_maxX, const float* p_maxY, int p_count, float* p_entry, unsigned int& p_xMask, unsigned int& p_yMask)
+{
+	p_xMask = 0;
+	p_yMask = 0;
+	for (int i = 0; i < p_count; i++)
+	{
+		float entryX, exitX, entryY, exitY;
+		sweepAxis(p_sweep.minX, p_sweep.maxX, p_sweep.deltaX, p_minX[i], p_maxX[i], entryX, exitX);
+		sweepAxis(p_sweep.minY, p_sweep.maxY, p_sweep.deltaY, p_minY[i], p_maxY[i], entryY, exitY);
+		//same operand order as maxps/minps
+		float entry = entryX > entryY ? entryX : entryY;
+		float exit = exitX < exitY ? exitX : exitY;
+		p_entry[i] = entry;
+		if (entry < exit && exit > 0 && entry >= MAX_START_DEPTH)
+		{
+			if (entryX > entryY)
+			{
+				p_xMask |= 1u << i;
+			}
+			else
+			{
+				p_yMask |= 1u << i;
+			}
+		}
+	}
+}
+
+#ifdef TILE_KERNEL_X86
+static void sweepAxisSSE2(float p_min, float p_max, float p_delta, __m128 p_boxMin, __m128 p_boxMax, __m128& p_entry, __m128& p_exit)
+{
+	if (p_delta != 0)
+	{
+		__m128 d = _mm_set1_ps(p_delta);
+		__m128 near = _mm_div_ps(_mm_sub_ps(p_boxMin, _mm_set1_ps(p_max)), d);
+		__m128 far = _mm_div_ps(_mm_sub_ps(p_boxMax, _mm_set1_ps(p_min)), d);
+		p_entry = p_delta > 0 ? near : far;
+		p_exit = p_delta > 0 ? far : near;
+		return;
+	}
+	__m128 inside = _mm_and_ps(_mm_cmplt_ps(p_boxMin, _mm_set1_ps(p_max)), _mm_cmpgt_ps(p_boxMax, _mm_set1_ps(p_min)));
+	__m128 inf = _mm_set1_ps(INFINITY);
+	__m128 negInf = _mm_set1_ps(-INFINITY);
+	p_entry = _mm_or_ps(_mm_and_ps(inside, negInf), _mm_andnot_ps(inside, inf));
+	p_exit = _mm_or_ps(_mm_and_ps(inside, inf), _mm_andnot_ps(inside, negInf));
+}
+
+static void sweepSSE2(const TileSweep& p_sweep, const float* p_minX, const float* p_minY, const float* p_maxX, const float* p_maxY, int p_count, float* p_entry, unsigned int& p_xMask, unsigned int& p_yMask)
+{
+	p_xMask = 0;
+	p_yMask = 0;
+	unsigned int valid = (1u << p_count) - 1;
+	for (int i = 0; i < TILE_BATCH; i += 4)
+	{
+		__m128 entryX, exitX, entryY, exitY;
+		sweepAxisSSE2(p_sweep.minX, p_sweep.maxX, p_sweep.deltaX, _mm_loadu_ps(p_minX + i), _mm_loadu_ps(p_maxX + i), entryX, exitX);
+		sweepAxisSSE2(p_sweep.minY, p_sweep.maxY, p_sweep.deltaY, _mm_loadu_ps(p_minY + i), _mm_loadu_ps(p_maxY + i), entryY, exitY);
+		__m128 entry = _mm_max_ps(entryX, entryY);
+		__m128 exit = _mm_min_ps(exitX, exitY);
+		_mm_storeu_ps(p_entry + i, entry);
+
+		__m128 hit = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(entry, exit), _mm_cmpgt_ps(exit, _mm_setzero_ps())), _mm_cmpge_ps(entry, _mm_set1_ps(MAX_START_DEPTH)));
+		__m128 xAxis = _mm_cmpgt_ps(entryX, entryY);
+		p_xMask |= (unsigned int)_mm_movemask_ps(_mm_and_ps(hit, xAxis)) << i;
+		p_yMask |= (unsigned int)_mm_movemask_ps(_mm_andnot_ps(xAxis, hit)) << i;
+	}
+	p_xMask &= valid;
+	p_yMask &= valid;
+}
+
+#ifdef TILE_KERNEL_X86_AVX2
+TARGET_AVX2
+static void sweepAxisAVX2(float p_min, float p_max, float p_delta, __m256 p_boxMin, __m256 p_boxMax, __m256& p_entry, __m256& p_exit)
+{
+	if (p_delta != 0)
+	{
+		__m256 d = _mm256_set1_ps(p_delta);
+		__m256 near = _mm256_div_ps(_mm256_sub_ps(p_boxMin, _mm256_set1_ps(p_max)), d);
+		__m256 far = _mm256_div_ps(_mm256_sub_ps(p_boxMax, _mm256_set1_ps(p_min)), d);
+		p_entry = p_delta > 0 ? near : far;
+		p_exit = p_delta > 0 ? far : near;
+		return;
+	}
+	__m256 inside = _mm256_and_ps(_mm256_cmp_ps(p_boxMin, _mm256_set1_ps(p_max), _CMP_LT_OQ), _mm256_cmp_ps(p_boxMax, _mm256_set1_ps(p_min), _CMP_GT_OQ));
+	p_entry = _mm256_blendv_ps(_mm256_set1_ps(INFINITY), _mm256_set1_ps(-INFINITY), inside);
+	p_exit = _mm256_blendv_ps(_mm256_set1_ps(-INFINITY), _mm256_set1_ps(INFINITY), inside);
+}
+
+TARGET_AVX2
+static void sweepAVX2(const TileSweep& p_sweep, const float* p_minX, const float* p_minY, const float* p_maxX, const float* p_maxY, int p_count, float* p_entry, unsigned int& p_xMask, unsigned int& p_yMask)
+{
+	__m256 entryX, exitX, entryY, exitY;
+	sweepAxisAVX2(p_sweep.minX, p_sweep.maxX, p_sweep.deltaX, _mm256_loadu_ps(p_minX), _mm256_loadu_ps(p_maxX), entryX, exitX);
+	sweepAxisAVX2(p_sweep.minY, p_sweep.maxY, p_sweep.deltaY, _mm256_loadu_ps(p_minY), _mm256_loadu_ps(p_maxY), entryY, exitY);
+	__m256 entry = _mm256_max_ps(entryX, entryY);
+	__m256 exit = _mm256_min_ps(exitX, exitY);
+	_mm256_storeu_ps(p_entry, entry);
+
+	__m256 hit = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(entry, exit, _CMP_LT_OQ), _mm256_cmp_ps(exit, _mm256_setzero_ps(), _CMP_GT_OQ)), _mm256_cmp_ps(entry, _mm256_set1_ps(MAX_START_DEPTH), _CMP_GE_OQ));
+	__m256 xAxis = _mm256_cmp_ps(entryX, entryY, _CMP_GT_OQ);
+	unsigned int valid = (1u << p_count) - 1;
+	p_xMask = (unsigned int)_mm256_movemask_ps(_mm256_and_ps(hit, xAxis)) & valid;
+	p_yMask = (unsigned int)_mm256_movemask_ps(_mm256_andnot_ps(xAxis, hit)) & valid;
+}
+#endif
+#endif
+
+static int supportedTileKernel()
+{
+#ifdef TILE_KERNEL_X86
+#ifdef TILE_KERNEL_X86_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return TILE_KERNEL_AVX2;
+	}
+#endif
+	return TILE_KERNEL_SSE2;
+#else
+	return TILE_KERNEL_SCALAR;
+#endif
+}
+
+static int tileKernel = TILE_KERNEL_SCALAR;
+static TileSweepFunc tileSweep = sweepScalar;
+//picked before main so worker threads never race on it
+static bool tileKernelPicked = (setTileKernel(TILE_KERNEL_COUNT), true);
+
+void setTileKernel(int p_kernel)
+{
+	int supported = supportedTileKernel();
+	tileKernel = p_kernel < supported ? p_kernel : supported;
+	if (tileKernel < 0)
+	{
+		tileKernel = TILE_KERNEL_SCALAR;
+	}
+	switch (tileKernel)
+	{
+#ifdef TILE_KERNEL_X86_AVX2
+		case TILE_KERNEL_AVX2:
+			tileSweep = sweepAVX2;
+		break;
+#endif
+#ifdef TILE_KERNEL_X86
+		case TILE_KERNEL_SSE2:
+			tileSweep = sweepSSE2;
+		break;
+#endif
+		default:
+			tileSweep = sweepScalar;
+		break;
+	}
+}
+
+TileSweepFunc getTileSweep()
+{
+	return tileSweep;
+}
+
+int getTileKernel()
+{
+	return tileKernel;
+}
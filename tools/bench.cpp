@@ -0,0 +1,428 @@
+//Times the physics and renderer hot paths and prints the results as JSON.
+//Rendering uses the software renderer on the dummy video driver, so it runs
+//the same on a machine without a GPU or display. Run from the repo root.
+//usage: bench [output.json]
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "RenderWindow.h"
+#include "EntityStore.h"
+#include "ParticleStore.h"
+#include "Ball.h"
+#include "Level.h"
+#include "LevelPack.h"
+#include "Simulation.h"
+#include "CollisionWorld.h"
+#include "Session.h"
+#include "JobSystem.h"
+#include "AllocCounter.h"
+#include "TripleBuffer.h"
+#include "CourseRenderer.h"
+
+const int SHOT_COUNT = 8;
+const int SHOT_REPEATS = 20;
+//a shot is given up on after 20 simulated seconds
+const int MAX_SHOT_TICKS = 240*20;
+const int QUADS_PER_FRAME = 1000;
+const int TEXTS_PER_FRAME = 100;
+const int RENDER_FRAMES = 200;
+const int FULL_FRAMES = 500;
+const int MANY_COURSES = 64;
+const int MANY_COURSE_TICKS = 240*30;
+const int COURSES_PER_JOB = 4;
+const int PARTICLE_COUNT = 100000;
+const int PARTICLE_UPDATES = 1000;
+const int PARTICLE_FRAMES = 20;
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point p_start)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - p_start).count();
+}
+
+//drag from the ball towards the opposite of where it should go, like a player would
+void aimShot(int p_shot, ShotInput* p_inputs)
+{
+	float angle = p_shot*(6.2831853f/SHOT_COUNT) + 0.3f;
+	float power = 0.4f + 0.6f*(p_shot % 3)/2;
+	Vector2f press(320, 240);
+	Vector2f release(press.x - std::cos(angle)*power*150, press.y - std::sin(angle)*power*150);
+
+	p_inputs[0].mouseDown = true;
+	p_inputs[0].mousePressed = true;
+	p_inputs[0].mousePos = press;
+	p_inputs[1].mouseDown = true;
+	p_inputs[1].mousePressed = false;
+	p_inputs[1].mousePos = release;
+	p_inputs[2].mouseDown = false;
+	p_inputs[2].mousePressed = false;
+	p_inputs[2].mousePos = release;
+}
+
+//every scripted shot from each spawn, stepped until the ball stops or sinks
+void benchPhysics(const LevelPack& p_pack, std::ostream& p_out)
+{
+	p_out << "\t\"physics\": [";
+	for (int level = 0; level < p_pack.getLevelCount(); level++)
+	{
+		Session session(&p_pack);
+		session.setCourseCount(p_pack.getLevel(level).courseCount, Ball(0, 0, 0, 0, 0, 0, 0));
+		session.loadLevel(level);
+		std::vector<SimEvent> events;
+		events.reserve(256);
+
+		long long ops = 0;
+		double ns = 0;
+		int sunk = 0;
+		for (int course = 0; course < session.getCourseCount(); course++)
+		{
+			Ball& ball = session.balls[course];
+			const Course& c = session.courses[course];
+			for (int repeat = 0; repeat < SHOT_REPEATS; repeat++)
+			{
+				for (int shot = 0; shot < SHOT_COUNT; shot++)
+				{
+					ShotInput inputs[3];
+					aimShot(shot, inputs);
+					ball.reset(c.spawn);
+					ball.getState().canMove = true;
+
+					Clock::time_point start = Clock::now();
+					int tick = 0;
+					for (; tick < MAX_SHOT_TICKS; tick++)
+					{
+						ball.update(inputs[tick < 2 ? tick : 2], session.world, c, events);
+						events.clear();
+						const BallState& s = ball.getState();
+						if ((tick > 2 && s.canMove) || s.scale.x < -1)
+						{
+							break;
+						}
+					}
+					ns += elapsedNs(start);
+					ops += tick + 1;
+					if (ball.isWin())
+					{
+						sunk++;
+					}
+				}
+			}
+		}
+		p_out << (level == 0 ? "\n" : ",\n");
+		p_out << "\t\t{\"level\": " << level << ", \"ops\": " << ops << ", \"sunk\": " << sunk << ", \"ns_per_op\": " << ns/ops << "}";
+	}
+	p_out << "\n\t],\n";
+}
+
+//a big grid of courses stepped on the calling thread, then across every core
+void benchCourses(const LevelPack& p_pack, std::ostream& p_out)
+{
+	p_out << "\t\"courses\": [\n";
+	int workerCounts[2] = {0, SDL_GetCPUCount() - 1};
+	for (int run = 0; run < 2; run++)
+	{
+		JobSystem jobs;
+		jobs.start(workerCounts[run]);
+		Session session(&p_pack);
+		session.setCourseCount(MANY_COURSES, Ball(0, 0, 0, 0, 0, 0, 0));
+		session.loadLevel(0);
+
+		ShotInput inputs[3];
+		Clock::time_point start = Clock::now();
+		for (int tick = 0; tick < MANY_COURSE_TICKS; tick++)
+		{
+			//a new shot every five seconds, whether the balls stopped or not
+			int phase = tick % (240*5);
+			if (phase == 0)
+			{
+				aimShot(tick/(240*5), inputs);
+			}
+			SessionStep step = {&session, &inputs[phase < 2 ? phase : 2]};
+			jobs.parallelFor(session.getCourseCount(), COURSES_PER_JOB, Session::stepCourses, &step);
+			session.endStep();
+			session.events.clear();
+		}
+		double ns = elapsedNs(start);
+		p_out << "\t\t{\"courses\": " << MANY_COURSES << ", \"workers\": " << jobs.getWorkerCount() << ", \"ops\": " << MANY_COURSE_TICKS
+			<< ", \"ns_per_op\": " << ns/MANY_COURSE_TICKS << "}" << (run == 1 ? "\n" : ",\n");
+	}
+	p_out << "\t],\n";
+}
+
+void writeResult(std::ostream& p_out, const char* p_name, long long p_ops, double p_ns, int p_frames, bool p_last)
+{
+	p_out << "\t\t{\"name\": \"" << p_name << "\", \"ops\": " << p_ops << ", \"ns_per_op\": " << p_ns/p_ops
+		<< ", \"frames_per_sec\": " << p_frames/(p_ns/1e9) << "}" << (p_last ? "\n" : ",\n");
+}
+
+void benchRender(RenderWindow& p_window, const Sprite* p_sprites, TTF_Font* p_font, std::ostream& p_out)
+{
+	p_out << "\t\"render\": [\n";
+
+	Clock::time_point start = Clock::now();
+	for (int frame = 0; frame < RENDER_FRAMES; frame++)
+	{
+		p_window.clear();
+		for (int i = 0; i < QUADS_PER_FRAME; i++)
+		{
+			p_window.render((i*37) % 624, (i*53) % 464, p_sprites[SPRITE_BALL]);
+		}
+		p_window.display();
+	}
+	writeResult(p_out, "sprite", (long long)RENDER_FRAMES*QUADS_PER_FRAME, elapsedNs(start), RENDER_FRAMES, false);
+
+	EntityStore points;
+	points.reserve(QUADS_PER_FRAME);
+	for (int i = 0; i < QUADS_PER_FRAME; i++)
+	{
+		int e = points.add(ENTITY_POINT, SPRITE_POINT, Vector2f((i*37) % 624, (i*53) % 464));
+		points.angle[e] = (i*7) % 360;
+	}
+	start = Clock::now();
+	for (int frame = 0; frame < RENDER_FRAMES; frame++)
+	{
+		p_window.clear();
+		p_window.render(points, p_sprites, ENTITY_POINT);
+		p_window.display();
+	}
+	writeResult(p_out, "rotated_sprite", (long long)RENDER_FRAMES*QUADS_PER_FRAME, elapsedNs(start), RENDER_FRAMES, false);
+
+	SDL_Color white = { 255, 255, 255 };
+	const char* texts[4] = {"STROKES: 12", "HOLE: 1", "HOLE: 2", "YOU COMPLETED THE COURSE!"};
+	start = Clock::now();
+	for (int frame = 0; frame < RENDER_FRAMES; frame++)
+	{
+		p_window.clear();
+		for (int i = 0; i < TEXTS_PER_FRAME; i++)
+		{
+			p_window.render((i*37) % 400, (i*53) % 440, texts[i % 4], p_font, white);
+		}
+		p_window.display();
+	}
+	writeResult(p_out, "text", (long long)RENDER_FRAMES*TEXTS_PER_FRAME, elapsedNs(start), RENDER_FRAMES, true);
+
+	p_out << "\t],\n";
+}
+
+//update() at 240Hz with the store kept full, first with every particle living
+//through the run, then with short lives so a 20th of them die and are
+//replaced each update; drawing covers both courses of a 2 course view
+void benchParticles(RenderWindow& p_window, const Sprite* p_sprites, std::ostream& p_out)
+{
+	p_out << "\t\"particles\": [\n";
+	ParticleStore particles;
+	particles.reserve(PARTICLE_COUNT);
+	float lives[2] = {1000, 20/240.0f};
+	const char* names[2] = {"update", "update_churn"};
+	for (int run = 0; run < 2; run++)
+	{
+		particles.clear();
+		particles.burst(0, SPRITE_BALL, 160, 240, PARTICLE_COUNT, 90, lives[run], 0.5f);
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < PARTICLE_UPDATES; i++)
+		{
+			particles.update(1/240.0f);
+			particles.burst(i & 1, SPRITE_BALL, 160, 240, PARTICLE_COUNT - particles.size(), 90, lives[run], 0.5f);
+		}
+		writeResult(p_out, names[run], (long long)PARTICLE_UPDATES*PARTICLE_COUNT, elapsedNs(start), PARTICLE_UPDATES, false);
+	}
+
+	ViewTransform views[2] = {{{0, 0, 320, 480}, 0, 0, 1}, {{320, 0, 320, 480}, 0, 0, 1}};
+	particles.clear();
+	particles.burst(0, SPRITE_BALL, 160, 240, PARTICLE_COUNT/2, 160, 1000, 0.5f);
+	particles.burst(1, SPRITE_BALL, 160, 240, PARTICLE_COUNT/2, 160, 1000, 0.5f);
+	//spread them out over a second
+	for (int i = 0; i < 60; i++)
+	{
+		particles.update(1/60.0f);
+	}
+	Clock::time_point start = Clock::now();
+	for (int frame = 0; frame < PARTICLE_FRAMES; frame++)
+	{
+		p_window.clear();
+		p_window.render(particles, p_sprites, views);
+		p_window.display();
+	}
+	writeResult(p_out, "draw", (long long)PARTICLE_FRAMES*PARTICLE_COUNT, elapsedNs(start), PARTICLE_FRAMES, true);
+
+	p_out << "\t],\n";
+}
+
+bool isResting(const BallState& p_state)
+{
+	return p_state.canMove || p_state.win;
+}
+
+//what game() does on a 60Hz frame: four physics ticks, effects queued and the
+//frame published as the simulation thread does, then the whole scene drawn by
+//the game's own CourseRenderer. False if a steady frame, one that neither
+//loads a level nor changes the static scene, allocated.
+bool benchFrames(RenderWindow& p_window, const Sprite* p_sprites, TTF_Font* p_font24, TTF_Font* p_font32, TTF_Font* p_font48, const LevelPack& p_pack, std::ostream& p_out)
+{
+	EntityStore entities;
+	Session session(&p_pack);
+	session.setCourseCount(2, createBall());
+	reserveEntities(p_pack, session.getCourseCount(), entities);
+	int shot = 0;
+	int tick = 0;
+	ShotInput inputs[3];
+	session.loadLevel(0);
+	int levelEntityCount = loadLevelEntities(p_pack, session, entities);
+	int levelLoads = 0;
+	aimShot(shot, inputs);
+	CourseRenderer renderer;
+	renderer.init(&p_window, p_sprites, p_font24, p_font32, p_font48, session.getCourseCount());
+	TripleBuffer<FrameSnapshot> frames;
+	for (int i = 0; i < TripleBuffer<FrameSnapshot>::SLOT_COUNT; i++)
+	{
+		reserveFrame(p_pack, session.getCourseCount(), frames.getSlot(i));
+	}
+	int steadyFrames = 0;
+	uint64_t steadyAllocations = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int frameIndex = 0; frameIndex < FULL_FRAMES; frameIndex++)
+	{
+		uint64_t allocations = getAllocationCount();
+		int staticChanges = renderer.getStaticChanges();
+		bool steady = true;
+		for (int step = 0; step < 4; step++, tick++)
+		{
+			//next level once both balls are in, next shot once both have stopped
+			if (session.step(inputs[tick < 2 ? tick : 2]))
+			{
+				if (session.finished)
+				{
+					session.loadLevel(0);
+				}
+				levelEntityCount = loadLevelEntities(p_pack, session, entities);
+				levelLoads++;
+				tick = -1;
+				steady = false;
+			}
+			else if (tick > 2 && isResting(session.balls[0].getState()) && isResting(session.balls[1].getState()))
+			{
+				aimShot(++shot % SHOT_COUNT, inputs);
+				tick = -1;
+			}
+			for (const SimEvent& e : session.events)
+			{
+				if (e.type == SIM_EVENT_HOLE || e.type == SIM_EVENT_BOUNCE)
+				{
+					renderer.queueEffect(e);
+				}
+			}
+			session.events.clear();
+		}
+		for (Ball& b : session.balls)
+		{
+			b.interpolate(entities, 0.5f);
+		}
+
+		FrameSnapshot& frame = frames.getBack();
+		copySession(session, entities, levelEntityCount, frame);
+		frame.levelLoads = levelLoads;
+		frame.state = 1;
+		SDL_strlcpy(frame.hudText, frame.strokeText, sizeof(frame.hudText));
+		frames.publish();
+		frames.acquire();
+		renderer.draw(frames.getFront(), 1/60.0f);
+		p_window.display();
+		if (renderer.getStaticChanges() != staticChanges)
+		{
+			steady = false;
+		}
+		if (steady)
+		{
+			steadyFrames++;
+			steadyAllocations += getAllocationCount() - allocations;
+		}
+	}
+	double ns = elapsedNs(start);
+	bool staticLayer = renderer.hasStaticLayer();
+	renderer.cleanUp();
+	p_out << "\t\"frame\": {\"static_layer\": " << (staticLayer ? "true" : "false") << ", \"frames\": " << FULL_FRAMES << ", \"ns_per_op\": " << ns/FULL_FRAMES << ", \"frames_per_sec\": " << FULL_FRAMES/(ns/1e9)
+		<< ", \"steady_frames\": " << steadyFrames << ", \"steady_allocations\": " << steadyAllocations << "}\n";
+	return steadyAllocations == 0;
+}
+
+int main(int argc, char* args[])
+{
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+	if (SDL_Init(SDL_INIT_VIDEO) != 0)
+	{
+		std::cout << "SDL_Init has failed. Error: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	if (!(IMG_Init(IMG_INIT_PNG)))
+		std::cout << "IMG_init has failed. Error: " << SDL_GetError() << std::endl;
+	if (TTF_Init() != 0)
+		std::cout << "TTF_init has failed. Error: " << SDL_GetError() << std::endl;
+
+	LevelPack pack;
+	if (!pack.open("res/levels/course.pack"))
+	{
+		return 1;
+	}
+
+	RenderWindow window("Twini-Golf bench", 640, 480);
+	if (!window.loadAtlas(spritePaths, SPRITE_COUNT))
+	{
+		return 1;
+	}
+	Sprite sprites[SPRITE_COUNT];
+	for (int i = 0; i < SPRITE_COUNT; i++)
+	{
+		sprites[i] = window.getSprite(spritePaths[i]);
+	}
+	TTF_Font* font24 = TTF_OpenFont("res/font/font.ttf", 24);
+	TTF_Font* font32 = TTF_OpenFont("res/font/font.ttf", 32);
+	TTF_Font* font48 = TTF_OpenFont("res/font/font.ttf", 48);
+	if (font24 == NULL || font32 == NULL || font48 == NULL)
+	{
+		std::cout << "Failed to open font. Error: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+
+	std::ostringstream out;
+	out << "{\n";
+	benchPhysics(pack, out);
+	benchCourses(pack, out);
+	benchRender(window, sprites, font24, out);
+	benchParticles(window, sprites, out);
+	bool allocationFree = benchFrames(window, sprites, font24, font32, font48, pack, out);
+	out << "}\n";
+
+	if (argc > 1)
+	{
+		std::ofstream file(args[1]);
+		file << out.str();
+	}
+	else
+	{
+		std::cout << out.str();
+	}
+
+	TTF_CloseFont(font48);
+	TTF_CloseFont(font32);
+	TTF_CloseFont(font24);
+	window.cleanUp();
+	TTF_Quit();
+	SDL_Quit();
+	if (!allocationFree)
+	{
+		std::cout << "Steady frames allocated memory, see steady_allocations" << std::endl;
+		return 1;
+	}
+	return 0;
+}
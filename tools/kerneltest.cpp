@@ -0,0 +1,241 @@
+//Checks that every tile kernel the CPU supports gives exactly the same bits as
+//the scalar one: masks and entry times, over sweeps through each level of the
+//pack batched the way CollisionWorld packs them, and over hand-made edge cases
+//(touching edges, zero and negative zero deltas, the start depth limit, empty
+//and infinite boxes, partial batches). Prints a line per kernel and exits with
+//an error on the first mismatch. Run from the repo root.
+//usage: kerneltest [sweeps per level]
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "CollisionWorld.h"
+#include "LevelPack.h"
+#include "TileKernel.h"
+
+const char* kernelNames[TILE_KERNEL_COUNT] = {"scalar", "sse2", "avx2"};
+
+struct KernelBatch
+{
+	TileSweep sweep;
+	int count;
+	float minX[TILE_BATCH];
+	float minY[TILE_BATCH];
+	float maxX[TILE_BATCH];
+	float maxY[TILE_BATCH];
+};
+
+static uint32_t nextRandom(uint32_t& p_seed)
+{
+	p_seed ^= p_seed << 13;
+	p_seed ^= p_seed >> 17;
+	p_seed ^= p_seed << 5;
+	return p_seed;
+}
+
+static float randomRange(uint32_t& p_seed, float p_min, float p_max)
+{
+	return p_min + (p_max - p_min)*(nextRandom(p_seed) % 100000)/100000.0f;
+}
+
+static TileSweep makeSweep(float p_x, float p_y, float p_size, float p_deltaX, float p_deltaY)
+{
+	TileSweep s;
+	s.minX = p_x;
+	s.minY = p_y;
+	s.maxX = p_x + p_size;
+	s.maxY = p_y + p_size;
+	s.deltaX = p_deltaX;
+	s.deltaY = p_deltaY;
+	return s;
+}
+
+//each cell's boxes in batches, padded with what the lanes past the end hold in
+//CollisionWorld, zeroes
+static void batchLevel(const CollisionGrid& p_grid, std::vector<KernelBatch>& p_batches)
+{
+	for (int cell = 0; cell < p_grid.cols*p_grid.rows; cell++)
+	{
+		int end = p_grid.cellStart[cell + 1];
+		for (int first = p_grid.cellStart[cell]; first < end; first += TILE_BATCH)
+		{
+			KernelBatch batch;
+			memset(&batch, 0, sizeof(batch));
+			batch.count = end - first < TILE_BATCH ? end - first : TILE_BATCH;
+			for (int i = 0; i < batch.count; i++)
+			{
+				const SimRect& b = p_grid.boxes[p_grid.cellTiles[first + i]];
+				batch.minX[i] = b.x;
+				batch.minY[i] = b.y;
+				batch.maxX[i] = b.x + b.w;
+				batch.maxY[i] = b.y + b.h;
+			}
+			p_batches.push_back(batch);
+		}
+	}
+}
+
+static void addEdgeCases(std::vector<KernelBatch>& p_batches)
+{
+	//one 32x32 box at the origin, swept at from every side
+	KernelBatch box;
+	memset(&box, 0, sizeof(box));
+	box.count = 1;
+	box.maxX[0] = 32;
+	box.maxY[0] = 32;
+	const float starts[] = {-16, -8, -0.001f, -0.0005f, 0, 8, 16, 24, 31.999f, 32, 40};
+	const float deltas[] = {-16, -1, -1e-30f, -0.0f, 0, 1e-30f, 1, 16, INFINITY, -INFINITY};
+	for (float x : starts)
+	{
+		for (float y : starts)
+		{
+			for (float dx : deltas)
+			{
+				for (float dy : deltas)
+				{
+					box.sweep = makeSweep(x, y, 8, dx, dy);
+					p_batches.push_back(box);
+				}
+			}
+		}
+	}
+
+	//entry times right at the kernels' start depth limit of 0.001 and either
+	//side of it, along both axes in both directions; box 0 covers [0, 32] and
+	//box 1 [-32, 0] on each axis
+	KernelBatch depth;
+	memset(&depth, 0, sizeof(depth));
+	depth.count = 2;
+	depth.maxX[0] = 32;
+	depth.maxY[0] = 32;
+	depth.minX[1] = -32;
+	depth.minY[1] = -32;
+	const float depths[] = {std::nextafter(0.001f, 0.0f), 0.001f, std::nextafter(0.001f, 1.0f)};
+	for (float d : depths)
+	{
+		const TileSweep sweeps[] = {
+			{-8, 8, d, 16, 1, 0},
+			{-d, -16, 8, -8, -1, 0},
+			{8, -8, 16, d, 0, 1},
+			{-16, -d, -8, 8, 0, -1}
+		};
+		for (const TileSweep& s : sweeps)
+		{
+			depth.sweep = s;
+			p_batches.push_back(depth);
+		}
+	}
+
+	//every partial batch, with a mix of hit, missed, empty and infinite boxes
+	//and garbage in the unused lanes
+	uint32_t seed = 0x9e3779b9;
+	for (int count = 0; count <= TILE_BATCH; count++)
+	{
+		for (int n = 0; n < 2000; n++)
+		{
+			KernelBatch batch;
+			for (int i = 0; i < TILE_BATCH; i++)
+			{
+				float x = randomRange(seed, -64, 64);
+				float y = randomRange(seed, -64, 64);
+				float w = nextRandom(seed) % 8 == 0 ? 0 : randomRange(seed, 1, 48);
+				float h = nextRandom(seed) % 8 == 0 ? 0 : randomRange(seed, 1, 48);
+				batch.minX[i] = x;
+				batch.minY[i] = y;
+				batch.maxX[i] = nextRandom(seed) % 32 == 0 ? INFINITY : x + w;
+				batch.maxY[i] = y + h;
+				if (i >= count && nextRandom(seed) % 2 == 0)
+				{
+					batch.minX[i] = NAN;
+				}
+			}
+			batch.count = count;
+			float dx = nextRandom(seed) % 4 == 0 ? 0 : randomRange(seed, -20, 20);
+			float dy = nextRandom(seed) % 4 == 0 ? 0 : randomRange(seed, -20, 20);
+			batch.sweep = makeSweep(randomRange(seed, -32, 32), randomRange(seed, -32, 32), 8, dx, dy);
+			p_batches.push_back(batch);
+		}
+	}
+}
+
+//false and a description of the first batch where p_func and p_reference differ
+static bool compareKernels(TileSweepFunc p_func, TileSweepFunc p_reference, const std::vector<KernelBatch>& p_batches)
+{
+	for (unsigned int n = 0; n < p_batches.size(); n++)
+	{
+		const KernelBatch& b = p_batches[n];
+		float entries[TILE_BATCH];
+		float expected[TILE_BATCH];
+		unsigned int xMask, yMask, expectedX, expectedY;
+		p_func(b.sweep, b.minX, b.minY, b.maxX, b.maxY, b.count, entries, xMask, yMask);
+		p_reference(b.sweep, b.minX, b.minY, b.maxX, b.maxY, b.count, expected, expectedX, expectedY);
+		//lanes past count hold whatever the kernel left there
+		bool match = xMask == expectedX && yMask == expectedY && memcmp(entries, expected, b.count*sizeof(float)) == 0;
+		if (!match)
+		{
+			std::cout << "batch " << n << " of " << b.count << " boxes, sweep (" << b.sweep.minX << ", " << b.sweep.minY << ") by ("
+				<< b.sweep.deltaX << ", " << b.sweep.deltaY << "): masks " << xMask << "/" << yMask << ", expected " << expectedX << "/" << expectedY << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* args[])
+{
+	int sweepsPerLevel = argc > 1 ? std::atoi(args[1]) : 20000;
+
+	LevelPack pack;
+	if (!pack.open("res/levels/course.pack"))
+	{
+		return 1;
+	}
+
+	//each level's batches swept at from random places across the level
+	std::vector<KernelBatch> batches;
+	uint32_t seed = 0x2545f491;
+	for (int level = 0; level < pack.getLevelCount(); level++)
+	{
+		CollisionGrid grid = pack.getGrid(pack.getLevel(level));
+		std::vector<KernelBatch> levelBatches;
+		batchLevel(grid, levelBatches);
+		if (levelBatches.empty())
+		{
+			continue;
+		}
+		float width = grid.cols*COLLISION_CELL_SIZE;
+		float height = grid.rows*COLLISION_CELL_SIZE;
+		for (int i = 0; i < sweepsPerLevel; i++)
+		{
+			KernelBatch batch = levelBatches[nextRandom(seed) % levelBatches.size()];
+			float dx = nextRandom(seed) % 8 == 0 ? 0 : randomRange(seed, -12, 12);
+			float dy = nextRandom(seed) % 8 == 0 ? 0 : randomRange(seed, -12, 12);
+			batch.sweep = makeSweep(grid.originX + randomRange(seed, 0, width), grid.originY + randomRange(seed, 0, height), 16, dx, dy);
+			batches.push_back(batch);
+		}
+	}
+	size_t levelBatchCount = batches.size();
+	addEdgeCases(batches);
+
+	int best = getTileKernel();
+	setTileKernel(TILE_KERNEL_SCALAR);
+	TileSweepFunc scalar = getTileSweep();
+	bool passed = true;
+	for (int kernel = TILE_KERNEL_SCALAR + 1; kernel < TILE_KERNEL_COUNT; kernel++)
+	{
+		setTileKernel(kernel);
+		if (getTileKernel() != kernel)
+		{
+			std::cout << kernelNames[kernel] << ": not supported here, skipped" << std::endl;
+			continue;
+		}
+		bool match = compareKernels(getTileSweep(), scalar, batches);
+		std::cout << kernelNames[kernel] << ": " << (match ? "matches" : "differs from") << " scalar over " << levelBatchCount
+			<< " level sweeps and " << batches.size() - levelBatchCount << " edge cases" << std::endl;
+		passed = passed && match;
+	}
+	setTileKernel(best);
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+//Compiles a readable course source (res/levels/course.txt) into the binary
+//level pack the game maps at startup.
+//usage: levelc <source.txt> <output.pack>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Level.h"
+#include "LevelPack.h"
+#include "CollisionWorld.h"
+#include "Simulation.h"
+
+struct SourceLevel
+{
+	int par = 0;
+	std::vector<PackCourse> courses;
+	std::vector<PackTile> tiles;
+};
+
+const char* tileNames[TILE_TYPE_COUNT] = {"dark32", "dark64", "light32", "light64"};
+
+int parseTileType(const std::string& p_name)
+{
+	for (int i = 0; i < TILE_TYPE_COUNT; i++)
+	{
+		if (p_name == tileNames[i])
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool parseSource(const char* p_filePath, std::vector<SourceLevel>& p_levels)
+{
+	std::ifstream in(p_filePath);
+	if (!in)
+	{
+		std::cout << "Failed to open " << p_filePath << std::endl;
+		return false;
+	}
+
+	bool inLevel = false;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+		std::istringstream words(line.substr(0, line.find('#')));
+		std::string keyword;
+		if (!(words >> keyword))
+		{
+			continue;
+		}
+
+		bool ok = true;
+		if (keyword == "level")
+		{
+			ok = !inLevel;
+			inLevel = true;
+			p_levels.push_back(SourceLevel());
+		}
+		else if (keyword == "end")
+		{
+			ok = inLevel && !p_levels.back().courses.empty();
+			inLevel = false;
+			if (ok)
+			{
+				std::vector<PackCourse>& courses = p_levels.back().courses;
+				for (unsigned int i = 0; i < courses.size(); i++)
+				{
+					if (courses[i].boundsW < 0)
+					{
+						courses[i].boundsW = PLAYFIELD_WIDTH/courses.size();
+						courses[i].boundsH = PLAYFIELD_HEIGHT;
+						courses[i].boundsX = i*courses[i].boundsW;
+						courses[i].boundsY = 0;
+					}
+				}
+			}
+		}
+		else if (!inLevel)
+		{
+			ok = false;
+		}
+		else if (keyword == "par")
+		{
+			ok = (bool)(words >> p_levels.back().par);
+		}
+		else if (keyword == "course")
+		{
+			std::string spawn, hole;
+			PackCourse c;
+			ok = (bool)(words >> spawn >> c.spawnX >> c.spawnY >> hole >> c.holeX >> c.holeY) && spawn == "spawn" && hole == "hole";
+			//without explicit bounds the course gets its column of the playfield, see below
+			c.boundsW = -1;
+			std::string bounds;
+			if (ok && words >> bounds)
+			{
+				ok = bounds == "bounds" && (bool)(words >> c.boundsX >> c.boundsY >> c.boundsW >> c.boundsH) && c.boundsW > 0 && c.boundsH > 0;
+			}
+			p_levels.back().courses.push_back(c);
+		}
+		else if (keyword == "tile")
+		{
+			std::string type;
+			PackTile t;
+			ok = (bool)(words >> type >> t.x >> t.y);
+			t.type = parseTileType(type);
+			ok = ok && t.type >= 0;
+			p_levels.back().tiles.push_back(t);
+		}
+		else
+		{
+			ok = false;
+		}
+
+		if (!ok)
+		{
+			std::cout << p_filePath << ":" << lineNumber << ": cannot read \"" << line << "\"" << std::endl;
+			return false;
+		}
+	}
+	if (inLevel)
+	{
+		std::cout << p_filePath << ": missing end after the last level" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+template <typename T>
+uint32_t append(std::vector<unsigned char>& p_out, const T* p_items, size_t p_count)
+{
+	uint32_t offset = p_out.size();
+	const unsigned char* bytes = (const unsigned char*)p_items;
+	p_out.insert(p_out.end(), bytes, bytes + p_count*sizeof(T));
+	return offset;
+}
+
+int main(int argc, char* args[])
+{
+	if (argc != 3)
+	{
+		std::cout << "usage: " << args[0] << " <source.txt> <output.pack>" << std::endl;
+		return 1;
+	}
+
+	std::vector<SourceLevel> levels;
+	if (!parseSource(args[1], levels))
+	{
+		return 1;
+	}
+
+	PackHeader header;
+	std::memcpy(header.magic, LEVEL_PACK_MAGIC, 4);
+	header.version = LEVEL_PACK_VERSION;
+	header.levelCount = levels.size();
+	header.levelsOffset = sizeof(PackHeader);
+
+	//header and level table first, then each level's arrays
+	std::vector<unsigned char> out;
+	append(out, &header, 1);
+	std::vector<PackLevel> table(levels.size());
+	append(out, table.data(), table.size());
+
+	for (unsigned int i = 0; i < levels.size(); i++)
+	{
+		SourceLevel& source = levels[i];
+		std::vector<SimRect> rects;
+		for (PackTile& t : source.tiles)
+		{
+			SimRect r;
+			r.x = t.x;
+			r.y = t.y;
+			r.w = getTileWidth(t.type);
+			r.h = getTileHeight(t.type);
+			rects.push_back(r);
+		}
+		CollisionWorld world;
+		world.build(rects);
+		const CollisionGrid& grid = world.getGrid();
+
+		PackLevel& l = table[i];
+		l.par = source.par;
+		l.courseCount = source.courses.size();
+		l.coursesOffset = append(out, source.courses.data(), source.courses.size());
+		l.tileCount = source.tiles.size();
+		l.tilesOffset = append(out, source.tiles.data(), source.tiles.size());
+		l.gridOriginX = grid.originX;
+		l.gridOriginY = grid.originY;
+		l.gridCols = grid.cols;
+		l.gridRows = grid.rows;
+		l.boxesOffset = append(out, grid.boxes, grid.boxCount);
+		l.boxCellsOffset = append(out, grid.boxCells, grid.boxCount*2);
+		const int emptyCellStart = 0;
+		l.cellStartOffset = grid.boxCount > 0 ? append(out, grid.cellStart, grid.cols*grid.rows + 1) : append(out, &emptyCellStart, 1);
+		l.cellTileCount = grid.boxCount > 0 ? grid.cellStart[grid.cols*grid.rows] : 0;
+		l.cellTilesOffset = append(out, grid.cellTiles, l.cellTileCount);
+	}
+	std::memcpy(out.data() + header.levelsOffset, table.data(), table.size()*sizeof(PackLevel));
+
+	std::ofstream file(args[2], std::ios::binary);
+	file.write((const char*)out.data(), out.size());
+	if (!file)
+	{
+		std::cout << "Failed to write " << args[2] << std::endl;
+		return 1;
+	}
+	std::cout << "Wrote " << levels.size() << " levels (" << out.size() << " bytes) to " << args[2] << std::endl;
+	return 0;
+}
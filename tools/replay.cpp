@@ -0,0 +1,61 @@
+//Plays an input log recorded with `main --record <file>` back through the
+//simulation with no window and no frame pacing, then checks the final state
+//hash against the one stored in the log. Run from the repo root.
+//usage: replay <file> [repeats]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "Ball.h"
+#include "InputLog.h"
+#include "LevelPack.h"
+#include "Session.h"
+#include "Simulation.h"
+
+int main(int argc, char* args[])
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: replay <file> [repeats]" << std::endl;
+		return 1;
+	}
+	int repeats = argc > 2 ? std::atoi(args[2]) : 1;
+	if (repeats < 1)
+	{
+		repeats = 1;
+	}
+
+	LevelPack pack;
+	InputPlayer player;
+	if (!pack.open("res/levels/course.pack") || !player.load(args[1]))
+	{
+		return 1;
+	}
+	const InputLogHeader& header = player.getHeader();
+
+	Session session(&pack);
+	uint64_t hash = 0;
+	long long ticks = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++)
+	{
+		session.setCourseCount(header.courseCount, Ball(0, 0, 0, 0, 0, 0, 0));
+		session.loadLevel(header.startLevel);
+		player.rewind();
+
+		ShotInput input;
+		while (player.next(input))
+		{
+			session.step(input);
+			session.events.clear();
+			ticks++;
+		}
+		hash = session.hash();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	bool match = hash == header.finalHash;
+	std::cout << (match ? "OK" : "MISMATCH") << " hash " << std::hex << hash << " expected " << header.finalHash << std::dec << std::endl;
+	std::cout << ticks << " ticks (" << ticks/SIM_TICK_RATE << " s of play) in " << seconds << " s, " << ticks/seconds << " ticks/s" << std::endl;
+	return match ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+//Checks how a ball meets the edges of its course: one stopped on or just past
+//a wall stays put and makes no events, and one shot into every wall bounces
+//back inside each time and goes quiet once it stops. Prints a line per case
+//and exits with an error if any fails.
+//usage: simtest
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "CollisionWorld.h"
+#include "Simulation.h"
+
+const SimRect TEST_BOUNDS = {0, 0, 320, 240};
+//long enough for any shot to run out
+const int MAX_TEST_TICKS = 240*30;
+
+static bool isInside(const BallState& p_ball)
+{
+	return p_ball.pos.x >= TEST_BOUNDS.x && p_ball.pos.x + BALL_SIZE <= TEST_BOUNDS.x + TEST_BOUNDS.w
+		&& p_ball.pos.y >= TEST_BOUNDS.y && p_ball.pos.y + BALL_SIZE <= TEST_BOUNDS.y + TEST_BOUNDS.h;
+}
+
+static bool isResting(const BallState& p_ball)
+{
+	return p_ball.velocity.x == 0 && p_ball.velocity.y == 0;
+}
+
+static void report(const char* p_name, bool p_passed, bool& p_allPassed)
+{
+	std::cout << (p_passed ? "ok   " : "FAIL ") << p_name << std::endl;
+	p_allPassed = p_allPassed && p_passed;
+}
+
+int main()
+{
+	CollisionWorld world;
+	world.build(std::vector<SimRect>());
+	Course course;
+	course.bounds = TEST_BOUNDS;
+	//out of reach, nothing is ever holed
+	course.hole = Vector2f(-1000, -1000);
+	ShotInput idle;
+	idle.mouseDown = false;
+	idle.mousePressed = false;
+	std::vector<SimEvent> events;
+	bool allPassed = true;
+
+	//at rest on each wall and a few pixels past it
+	const float right = TEST_BOUNDS.x + TEST_BOUNDS.w - BALL_SIZE;
+	const float bottom = TEST_BOUNDS.y + TEST_BOUNDS.h - BALL_SIZE;
+	const Vector2f resting[] = {
+		Vector2f(right, 100), Vector2f(right + 3, 100),
+		Vector2f(0, 100), Vector2f(-3, 100),
+		Vector2f(100, bottom), Vector2f(100, bottom + 3),
+		Vector2f(100, 0), Vector2f(100, -3)
+	};
+	for (const Vector2f& pos : resting)
+	{
+		BallState ball;
+		resetBall(ball, pos);
+		events.clear();
+		for (int tick = 0; tick < 240; tick++)
+		{
+			stepBall(ball, SIM_STEP_MS, idle, world, course, events);
+		}
+		char name[96];
+		snprintf(name, sizeof(name), "resting at (%g, %g) makes no events", pos.x, pos.y);
+		report(name, events.empty() && isInside(ball) && isResting(ball), allPassed);
+	}
+
+	//shot hard into each wall and corner
+	const Vector2f drags[] = {
+		Vector2f(-150, 0), Vector2f(150, 0), Vector2f(0, -150), Vector2f(0, 150),
+		Vector2f(-150, -150), Vector2f(150, 150), Vector2f(-140, 90), Vector2f(60, -150)
+	};
+	for (const Vector2f& drag : drags)
+	{
+		BallState ball;
+		resetBall(ball, Vector2f(150, 110));
+		aimBall(ball, drag);
+		events.clear();
+		int bounces = 0;
+		bool stayedInside = true;
+		int tick = 0;
+		for (; tick < MAX_TEST_TICKS && (tick == 0 || !isResting(ball)); tick++)
+		{
+			stepBall(ball, SIM_STEP_MS, idle, world, course, events);
+			stayedInside = stayedInside && isInside(ball);
+		}
+		for (const SimEvent& e : events)
+		{
+			bounces += e.type == SIM_EVENT_BOUNCE;
+		}
+		//once stopped it stays quiet, wherever it stopped
+		events.clear();
+		for (int i = 0; i < 240; i++)
+		{
+			stepBall(ball, SIM_STEP_MS, idle, world, course, events);
+		}
+		char name[96];
+		snprintf(name, sizeof(name), "shot by (%g, %g) bounces %d times then rests", drag.x, drag.y, bounces);
+		report(name, bounces > 0 && stayedInside && tick < MAX_TEST_TICKS && events.empty(), allPassed);
+	}
+	return allPassed ? 0 : 1;
+}
@@ -0,0 +1,520 @@
+//Finds par for every level in the level pack by searching the shot space
+//with the real physics, headless and across every core. One mouse shoots
+//every course of a level at once, so a level's par is the fewest shots that
+//sink all of its balls; each course's own par is printed alongside. Each
+//stroke tries a coarse grid of angles and powers from every position reached
+//so far, then refines around the shots that came closest to sinking. Positions
+//are memoised on a small grid, so shots that leave the balls in the same place
+//are only searched from once. Run from the repo root.
+//usage: solver [threads]
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+#include "CollisionWorld.h"
+#include "JobSystem.h"
+#include "LevelPack.h"
+#include "Session.h"
+#include "Simulation.h"
+
+const int MAX_STROKES = 8;
+const int ANGLE_STEPS = 64;
+//power is the power bar's fill, velocity1D is capped at 1 however far the mouse is dragged
+const int POWER_STEPS = 8;
+const int REFINE_SHOTS = 4;
+const int REFINE_ROUNDS = 3;
+//positions kept after each stroke, closest to the holes by path distance first
+const int BEAM_WIDTH = 48;
+const float MEMO_CELL_SIZE = 4;
+const float PATH_CELL_SIZE = 8;
+//a shot still rolling after 20 simulated seconds is given up on
+const int MAX_SHOT_TICKS = 240*20;
+const int SHOTS_PER_JOB = 8;
+//ranks a ball still out above any distance a sunk one could be behind by
+const float UNHOLED_PENALTY = 1e6f;
+
+struct Shot
+{
+	float angle; //radians, the direction the balls leave in
+	float power; //0..1
+};
+
+//where the balls are before a stroke, and the stroke that got them there
+struct Node
+{
+	std::vector<BallState> balls;
+	int parent;
+	Shot shot;
+};
+
+struct ShotResult
+{
+	std::vector<BallState> balls;
+	int holed;
+	float closest; //summed over the balls still out, how near each came to sinking, in px
+	int ticks;
+};
+
+struct ShotTask
+{
+	int node;
+	Shot shot;
+};
+
+struct LevelSearch
+{
+	const CollisionWorld* world;
+	const std::vector<Course>* courses;
+	const std::vector<Node>* nodes;
+	const std::vector<ShotTask>* tasks;
+	std::vector<ShotResult>* results;
+};
+
+//drags from the middle of the window the opposite way to the shot, then lets go
+static void shotInputs(const Shot& p_shot, ShotInput* p_inputs)
+{
+	Vector2f press(320, 240);
+	Vector2f release(press.x - std::cos(p_shot.angle)*p_shot.power*150, press.y - std::sin(p_shot.angle)*p_shot.power*150);
+	p_inputs[0].mouseDown = true;
+	p_inputs[0].mousePressed = true;
+	p_inputs[0].mousePos = press;
+	p_inputs[1].mouseDown = true;
+	p_inputs[1].mousePressed = false;
+	p_inputs[1].mousePos = release;
+	p_inputs[2].mouseDown = false;
+	p_inputs[2].mousePressed = false;
+	p_inputs[2].mousePos = release;
+}
+
+//every ball takes the same shot, like off the game's one mouse, until each has stopped or sunk
+static void playShot(const std::vector<BallState>& p_balls, const Shot& p_shot, const CollisionWorld& p_world, const std::vector<Course>& p_courses, std::vector<SimEvent>& p_events, ShotResult& p_result)
+{
+	ShotInput inputs[3];
+	shotInputs(p_shot, inputs);
+
+	ShotResult& r = p_result;
+	r.balls = p_balls;
+	r.holed = 0;
+	r.closest = 0;
+	r.ticks = 0;
+	for (unsigned int i = 0; i < r.balls.size(); i++)
+	{
+		BallState& b = r.balls[i];
+		const Course& course = p_courses[i];
+		if (b.win)
+		{
+			r.holed++;
+			continue;
+		}
+		float closest = 1e9f;
+		int tick = 0;
+		for (; tick < MAX_SHOT_TICKS; tick++)
+		{
+			stepBall(b, SIM_STEP_MS, inputs[tick < 2 ? tick : 2], p_world, course, p_events);
+			p_events.clear();
+			//the ball drops in when its top left corner is within 4px of the hole's
+			float dx = b.pos.x - course.hole.x;
+			float dy = b.pos.y - course.hole.y;
+			closest = std::min(closest, std::sqrt(dx*dx + dy*dy));
+			if (b.win || (tick > 2 && b.canMove))
+			{
+				break;
+			}
+		}
+		r.ticks += tick + 1;
+		if (b.win)
+		{
+			r.holed++;
+		}
+		else
+		{
+			r.closest += closest;
+		}
+	}
+}
+
+static float shotScore(const ShotResult& p_result)
+{
+	return (p_result.balls.size() - p_result.holed)*UNHOLED_PENALTY + p_result.closest;
+}
+
+//JobFunc over a range of a LevelSearch's tasks
+static void playShots(void* p_search, int p_begin, int p_end)
+{
+	LevelSearch* search = (LevelSearch*)p_search;
+	std::vector<SimEvent> events;
+	events.reserve(MAX_EVENTS_PER_STEP);
+	for (int i = p_begin; i < p_end; i++)
+	{
+		const ShotTask& task = (*search->tasks)[i];
+		const std::vector<BallState>& balls = (*search->nodes)[task.node].balls;
+		playShot(balls, task.shot, *search->world, *search->courses, events, (*search->results)[i]);
+	}
+}
+
+//Walking distance to the hole from every PATH_CELL_SIZE cell of the course,
+//going around tiles, or -1 where the ball can't be.
+class PathField
+{
+public:
+	void build(const CollisionWorld& p_world, const Course& p_course)
+	{
+		const SimRect& bounds = p_course.bounds;
+		originX = bounds.x;
+		originY = bounds.y;
+		cols = std::max(1, (int)(bounds.w/PATH_CELL_SIZE));
+		rows = std::max(1, (int)(bounds.h/PATH_CELL_SIZE));
+		std::vector<bool> blocked(cols*rows, false);
+		const CollisionGrid& grid = p_world.getGrid();
+		for (int y = 0; y < rows; y++)
+		{
+			for (int x = 0; x < cols; x++)
+			{
+				float bx = originX + x*PATH_CELL_SIZE;
+				float by = originY + y*PATH_CELL_SIZE;
+				for (int i = 0; i < grid.boxCount; i++)
+				{
+					const SimRect& t = grid.boxes[i];
+					if (bx < t.x + t.w && bx + BALL_SIZE > t.x && by < t.y + t.h && by + BALL_SIZE > t.y)
+					{
+						blocked[y*cols + x] = true;
+						break;
+					}
+				}
+			}
+		}
+
+		distances.assign(cols*rows, -1);
+		std::vector<int> open;
+		int start = cellIndex(p_course.hole);
+		distances[start] = 0;
+		open.push_back(start);
+		for (unsigned int head = 0; head < open.size(); head++)
+		{
+			int cell = open[head];
+			int x = cell % cols;
+			int y = cell / cols;
+			const int offsetsX[4] = {1, -1, 0, 0};
+			const int offsetsY[4] = {0, 0, 1, -1};
+			for (int i = 0; i < 4; i++)
+			{
+				int nx = x + offsetsX[i];
+				int ny = y + offsetsY[i];
+				if (nx < 0 || ny < 0 || nx >= cols || ny >= rows)
+				{
+					continue;
+				}
+				int next = ny*cols + nx;
+				if (blocked[next] || distances[next] >= 0)
+				{
+					continue;
+				}
+				distances[next] = distances[cell] + PATH_CELL_SIZE;
+				open.push_back(next);
+			}
+		}
+	}
+	float distance(Vector2f p_pos) const
+	{
+		float d = distances[cellIndex(p_pos)];
+		return d < 0 ? 1e9f : d;
+	}
+private:
+	int cellIndex(Vector2f p_pos) const
+	{
+		int x = std::min(cols - 1, std::max(0, (int)((p_pos.x - originX)/PATH_CELL_SIZE)));
+		int y = std::min(rows - 1, std::max(0, (int)((p_pos.y - originY)/PATH_CELL_SIZE)));
+		return y*cols + x;
+	}
+	float originX = 0;
+	float originY = 0;
+	int cols = 1;
+	int rows = 1;
+	std::vector<float> distances;
+};
+
+struct Solution
+{
+	int par; //0 when no sequence was found within MAX_STROKES
+	std::vector<Shot> shots;
+	long long shotCount;
+	long long tickCount;
+};
+
+//Searches for the shortest sequence of shots sinking every ball, each
+//ball on its own course and all of them taking every shot.
+class Solver
+{
+public:
+	Solver(JobSystem& p_jobs, const CollisionWorld& p_world, const std::vector<Course>& p_courses)
+		:jobs(p_jobs), world(p_world), courses(p_courses), paths(p_courses.size())
+	{
+		for (unsigned int i = 0; i < courses.size(); i++)
+		{
+			paths[i].build(world, courses[i]);
+		}
+	}
+	Solution solve(const std::vector<BallState>& p_spawn);
+private:
+	void run();
+	float distance(const std::vector<BallState>& p_balls) const;
+	Solution finish(int p_strokes, int p_node, const Shot& p_shot);
+	JobSystem& jobs;
+	const CollisionWorld& world;
+	const std::vector<Course>& courses;
+	std::vector<PathField> paths;
+	std::vector<Node> nodes;
+	std::vector<ShotTask> tasks;
+	std::vector<ShotResult> results;
+	long long shotCount = 0;
+	long long tickCount = 0;
+};
+
+//plays every task, results[i] belongs to tasks[i] whichever thread played it
+void Solver::run()
+{
+	results.resize(tasks.size());
+	LevelSearch search = {&world, &courses, &nodes, &tasks, &results};
+	int queueSpace = (jobs.getWorkerCount() + 1)*JOB_QUEUE_SIZE;
+	int grain = std::max(SHOTS_PER_JOB, (int)tasks.size()/queueSpace + 1);
+	jobs.parallelFor(tasks.size(), grain, playShots, &search);
+	shotCount += tasks.size();
+	for (const ShotResult& r : results)
+	{
+		tickCount += r.ticks;
+	}
+}
+
+float Solver::distance(const std::vector<BallState>& p_balls) const
+{
+	float d = 0;
+	for (unsigned int i = 0; i < p_balls.size(); i++)
+	{
+		if (!p_balls[i].win)
+		{
+			d += UNHOLED_PENALTY + paths[i].distance(p_balls[i].pos);
+		}
+	}
+	return d;
+}
+
+Solution Solver::finish(int p_strokes, int p_node, const Shot& p_shot)
+{
+	Solution s;
+	s.par = p_strokes;
+	s.shots.push_back(p_shot);
+	for (int i = p_node; nodes[i].parent >= 0; i = nodes[i].parent)
+	{
+		s.shots.push_back(nodes[i].shot);
+	}
+	std::reverse(s.shots.begin(), s.shots.end());
+	s.shotCount = shotCount;
+	s.tickCount = tickCount;
+	return s;
+}
+
+Solution Solver::solve(const std::vector<BallState>& p_spawn)
+{
+	Node root;
+	root.balls = p_spawn;
+	root.parent = -1;
+	nodes.assign(1, root);
+	std::vector<int> frontier(1, 0);
+	std::unordered_set<uint64_t> seen;
+
+	const float angleStep = 6.2831853f/ANGLE_STEPS;
+	const float powerStep = 1.0f/POWER_STEPS;
+	for (int strokes = 1; strokes <= MAX_STROKES && !frontier.empty(); strokes++)
+	{
+		//coarse grid from every position in the beam
+		tasks.clear();
+		for (int node : frontier)
+		{
+			for (int a = 0; a < ANGLE_STEPS; a++)
+			{
+				for (int p = 1; p <= POWER_STEPS; p++)
+				{
+					ShotTask t = {node, {a*angleStep, p*powerStep}};
+					tasks.push_back(t);
+				}
+			}
+		}
+		run();
+		std::vector<ShotTask> played = tasks;
+		std::vector<ShotResult> outcomes = results;
+
+		//then ever finer grids around the shots that came closest to sinking
+		float refineAngle = angleStep;
+		float refinePower = powerStep;
+		for (int round = 0; round <= REFINE_ROUNDS; round++)
+		{
+			for (unsigned int i = 0; i < outcomes.size(); i++)
+			{
+				if (outcomes[i].holed == (int)courses.size())
+				{
+					return finish(strokes, played[i].node, played[i].shot);
+				}
+			}
+			if (round == REFINE_ROUNDS)
+			{
+				break;
+			}
+			refineAngle *= 0.5f;
+			refinePower *= 0.5f;
+			tasks.clear();
+			for (int node : frontier)
+			{
+				std::vector<int> best;
+				for (unsigned int i = 0; i < outcomes.size(); i++)
+				{
+					if (played[i].node == node)
+					{
+						best.push_back(i);
+					}
+				}
+				int keep = std::min((int)best.size(), REFINE_SHOTS);
+				std::partial_sort(best.begin(), best.begin() + keep, best.end(), [&outcomes](int a, int b)
+				{
+					float scoreA = shotScore(outcomes[a]);
+					float scoreB = shotScore(outcomes[b]);
+					return scoreA < scoreB || (scoreA == scoreB && a < b);
+				});
+				for (int k = 0; k < keep; k++)
+				{
+					const Shot& centre = played[best[k]].shot;
+					for (int da = -1; da <= 1; da++)
+					{
+						for (int dp = -1; dp <= 1; dp++)
+						{
+							float power = centre.power + dp*refinePower;
+							if ((da == 0 && dp == 0) || power <= 0 || power > 1)
+							{
+								continue;
+							}
+							ShotTask t = {node, {centre.angle + da*refineAngle, power}};
+							tasks.push_back(t);
+						}
+					}
+				}
+			}
+			run();
+			played.insert(played.end(), tasks.begin(), tasks.end());
+			outcomes.insert(outcomes.end(), results.begin(), results.end());
+		}
+
+		//the next stroke starts from every new set of resting places, nearest first
+		std::vector<int> next;
+		for (unsigned int i = 0; i < outcomes.size(); i++)
+		{
+			const std::vector<BallState>& balls = outcomes[i].balls;
+			uint64_t key = 14695981039346656037ull;
+			bool resting = true;
+			for (const BallState& b : balls)
+			{
+				resting = resting && (b.canMove || b.win);
+				int cell[3] = {(int)std::floor(b.pos.x/MEMO_CELL_SIZE), (int)std::floor(b.pos.y/MEMO_CELL_SIZE), b.win};
+				for (int c : cell)
+				{
+					key = (key ^ (uint32_t)c)*1099511628211ull;
+				}
+			}
+			if (!resting || !seen.insert(key).second)
+			{
+				continue;
+			}
+			Node n;
+			n.balls = balls;
+			n.parent = played[i].node;
+			n.shot = played[i].shot;
+			nodes.push_back(n);
+			next.push_back(nodes.size() - 1);
+		}
+		std::stable_sort(next.begin(), next.end(), [this](int a, int b)
+		{
+			return distance(nodes[a].balls) < distance(nodes[b].balls);
+		});
+		if ((int)next.size() > BEAM_WIDTH)
+		{
+			next.resize(BEAM_WIDTH);
+		}
+		frontier = next;
+	}
+
+	Solution s;
+	s.par = 0;
+	s.shotCount = shotCount;
+	s.tickCount = tickCount;
+	return s;
+}
+
+static void printSolution(const Solution& p_solution)
+{
+	if (p_solution.par == 0)
+	{
+		std::cout << "no solution within " << MAX_STROKES << " strokes" << std::endl;
+		return;
+	}
+	std::cout << "par " << p_solution.par << ",";
+	for (const Shot& shot : p_solution.shots)
+	{
+		std::cout << " " << std::fixed << std::setprecision(2) << shot.angle*180/3.14159265f << "deg@" << std::setprecision(1) << shot.power*100 << "%" << std::defaultfloat;
+	}
+	std::cout << std::endl;
+}
+
+int main(int argc, char* args[])
+{
+	int threads = argc > 1 ? std::atoi(args[1]) : -1;
+
+	LevelPack pack;
+	if (!pack.open("res/levels/course.pack"))
+	{
+		return 1;
+	}
+	JobSystem jobs;
+	jobs.start(threads);
+
+	long long shots = 0;
+	long long ticks = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int level = 0; level < pack.getLevelCount(); level++)
+	{
+		int courseCount = pack.getLevel(level).courseCount;
+		Session session(&pack);
+		session.setCourseCount(courseCount, Ball(0, 0, 0, 0, 0, 0, 0));
+		session.loadLevel(level);
+		std::vector<BallState> spawn;
+		for (Ball& b : session.balls)
+		{
+			spawn.push_back(b.getState());
+		}
+
+		Solver solver(jobs, session.world, session.courses);
+		Solution s = solver.solve(spawn);
+		shots += s.shotCount;
+		ticks += s.tickCount;
+		std::cout << "level " << level << " (course.pack says par " << pack.getLevel(level).par << "): ";
+		printSolution(s);
+
+		for (int course = 0; course < courseCount; course++)
+		{
+			std::vector<Course> alone(1, session.courses[course]);
+			Solver courseSolver(jobs, session.world, alone);
+			Solution c = courseSolver.solve(std::vector<BallState>(1, spawn[course]));
+			shots += c.shotCount;
+			ticks += c.tickCount;
+			std::cout << "\thole " << level*courseCount + course + 1 << " alone: ";
+			printSolution(c);
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << shots << " shots, " << ticks << " ticks on " << jobs.getWorkerCount() + 1 << " threads in " << seconds << " s, " << ticks/seconds << " ticks/s" << std::endl;
+	jobs.stop();
+	return 0;
+}
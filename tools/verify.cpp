@@ -0,0 +1,228 @@
+//Verifies input logs recorded with `main --record <file>`, as submitted with a
+//leaderboard score: each one is played back headless through the real physics
+//and accepted only if it finishes the last level and ends in exactly the state
+//hash it claims. Logs are spread over every core. Prints a line per log, in
+//the order given, then the total and how many were verified per second.
+//Arguments are log files or directories of them; - reads paths from stdin,
+//one per line, so a queue of submissions can be piped through. Run from the
+//repo root.
+//usage: verify [--threads n] <file|dir|-> ...
+#include <SDL2/SDL.h>
+#include <dirent.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Ball.h"
+#include "InputLog.h"
+#include "JobSystem.h"
+#include "LevelPack.h"
+#include "Session.h"
+#include "Simulation.h"
+
+const int LOGS_PER_JOB = 16;
+//paths read from stdin are verified this many at a time
+const unsigned int STREAM_BATCH_SIZE = 4096;
+//an hour of play, anything longer is not worth simulating
+const uint32_t MAX_LOG_TICKS = SIM_TICK_RATE*60*60;
+
+enum Verdict
+{
+	VERDICT_ACCEPT,
+	VERDICT_UNREADABLE,
+	VERDICT_TOO_LONG,
+	VERDICT_MISMATCH,
+	VERDICT_UNFINISHED
+};
+
+const char* verdictNames[] = {"accept", "reject unreadable", "reject too long", "reject hash mismatch", "reject unfinished"};
+
+struct Verification
+{
+	Verdict verdict;
+	int strokes;
+	uint32_t ticks;
+};
+
+struct VerifyBatch
+{
+	const LevelPack* pack;
+	const std::vector<std::string>* paths;
+	std::vector<Verification>* results;
+};
+
+//the score is what the HUD shows, the most strokes any ball took
+static int getStrokes(const Session& p_session)
+{
+	int strokes = 0;
+	for (const Ball& b : p_session.balls)
+	{
+		strokes = std::max(strokes, b.getState().strokes);
+	}
+	return strokes;
+}
+
+//JobFunc, each job replays its logs on a session of its own
+static void verifyLogs(void* p_batch, int p_begin, int p_end)
+{
+	VerifyBatch* batch = (VerifyBatch*)p_batch;
+	Session session(batch->pack);
+	InputPlayer player;
+	for (int i = p_begin; i < p_end; i++)
+	{
+		Verification& v = (*batch->results)[i];
+		v.verdict = VERDICT_UNREADABLE;
+		v.strokes = 0;
+		v.ticks = 0;
+		//load() also turns away headers the game never writes: a start level
+		//other than 0, or a course count outside 1..MAX_COURSES
+		if (!player.load((*batch->paths)[i].c_str()))
+		{
+			continue;
+		}
+		const InputLogHeader& header = player.getHeader();
+		if (header.tickCount > MAX_LOG_TICKS)
+		{
+			v.verdict = VERDICT_TOO_LONG;
+			continue;
+		}
+		//stroke counts carry over from level to level, so every log starts on fresh balls
+		session.setCourseCount(header.courseCount, Ball(0, 0, 0, 0, 0, 0, 0));
+		session.loadLevel(header.startLevel);
+
+		//nothing changes once the last level is done, so the rest of the log
+		//can't affect the hash
+		ShotInput input;
+		while (!session.finished && player.next(input))
+		{
+			session.step(input);
+			session.events.clear();
+			v.ticks++;
+		}
+		v.strokes = getStrokes(session);
+		if (session.hash() != header.finalHash)
+		{
+			v.verdict = VERDICT_MISMATCH;
+		}
+		else if (!session.finished)
+		{
+			v.verdict = VERDICT_UNFINISHED;
+		}
+		else
+		{
+			v.verdict = VERDICT_ACCEPT;
+		}
+	}
+}
+
+static void addPath(const char* p_path, std::vector<std::string>& p_paths)
+{
+	DIR* dir = opendir(p_path);
+	if (dir == NULL)
+	{
+		p_paths.push_back(p_path);
+		return;
+	}
+	std::vector<std::string> files;
+	while (dirent* entry = readdir(dir))
+	{
+		const char* name = entry->d_name;
+		size_t length = strlen(name);
+		if (length > 4 && strcmp(name + length - 4, ".til") == 0)
+		{
+			files.push_back(std::string(p_path) + "/" + name);
+		}
+	}
+	closedir(dir);
+	std::sort(files.begin(), files.end());
+	p_paths.insert(p_paths.end(), files.begin(), files.end());
+}
+
+struct Totals
+{
+	long long logs = 0;
+	long long accepted = 0;
+	long long ticks = 0;
+};
+
+static void verify(JobSystem& p_jobs, const LevelPack& p_pack, const std::vector<std::string>& p_paths, Totals& p_totals)
+{
+	std::vector<Verification> results(p_paths.size());
+	VerifyBatch batch = {&p_pack, &p_paths, &results};
+	p_jobs.parallelFor(p_paths.size(), LOGS_PER_JOB, verifyLogs, &batch);
+	for (unsigned int i = 0; i < p_paths.size(); i++)
+	{
+		const Verification& v = results[i];
+		std::cout << p_paths[i] << " " << verdictNames[v.verdict] << " strokes " << v.strokes << "\n";
+		p_totals.logs++;
+		p_totals.accepted += v.verdict == VERDICT_ACCEPT;
+		p_totals.ticks += v.ticks;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	int threads = -1;
+	bool readStdin = false;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+		{
+			threads = std::atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "-") == 0)
+		{
+			readStdin = true;
+		}
+		else
+		{
+			addPath(args[i], paths);
+		}
+	}
+	if (paths.empty() && !readStdin)
+	{
+		std::cout << "usage: verify [--threads n] <file|dir|-> ..." << std::endl;
+		return 1;
+	}
+
+	LevelPack pack;
+	if (!pack.open("res/levels/course.pack"))
+	{
+		return 1;
+	}
+	JobSystem jobs;
+	jobs.start(threads);
+
+	Totals totals;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	verify(jobs, pack, paths, totals);
+	if (readStdin)
+	{
+		paths.clear();
+		std::string line;
+		while (std::getline(std::cin, line))
+		{
+			if (line.empty())
+			{
+				continue;
+			}
+			paths.push_back(line);
+			if (paths.size() == STREAM_BATCH_SIZE)
+			{
+				verify(jobs, pack, paths, totals);
+				paths.clear();
+			}
+		}
+		verify(jobs, pack, paths, totals);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << totals.logs << " logs, " << totals.accepted << " accepted, " << totals.logs - totals.accepted << " rejected in " << seconds << " s on "
+		<< jobs.getWorkerCount() + 1 << " threads, " << totals.logs/seconds << " verifications/s, " << totals.ticks/seconds << " ticks/s" << std::endl;
+	jobs.stop();
+	return totals.accepted == totals.logs ? 0 : 1;
+}
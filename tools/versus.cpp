@@ -0,0 +1,143 @@
+//A headless versus peer for testing the network code: a bot takes random
+//shots on its course while the two processes keep each other in lockstep,
+//then both print the state hash of the same final tick, which must match.
+//Run from the repo root, the host first:
+//  versus host <port> [ticks] [loss%] [latency ms]
+//  versus join <host> <port> [ticks] [loss%] [latency ms] [desync]
+//desync nudges the joining ball once the confirmed tick passes halfway; the
+//join side exits with an error unless that is caught and resynced.
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "Ball.h"
+#include "LevelPack.h"
+#include "Lockstep.h"
+#include "Net.h"
+#include "Session.h"
+#include "Simulation.h"
+
+//the bot sends about as often as a 60 Hz game would, stalled or not
+const double SEND_INTERVAL_SECONDS = 1/60.0;
+//how long to keep answering once done, so the peer can finish too
+const double LINGER_SECONDS = 1;
+
+static uint32_t nextRandom(uint32_t& p_seed)
+{
+	p_seed ^= p_seed << 13;
+	p_seed ^= p_seed >> 17;
+	p_seed ^= p_seed << 5;
+	return p_seed;
+}
+
+int main(int argc, char* args[])
+{
+	bool host = argc >= 3 && strcmp(args[1], "host") == 0;
+	bool join = argc >= 4 && strcmp(args[1], "join") == 0;
+	if (!host && !join)
+	{
+		std::cout << "usage: versus host <port> [ticks] [loss%] [latency ms]" << std::endl;
+		std::cout << "       versus join <host> <port> [ticks] [loss%] [latency ms] [desync]" << std::endl;
+		return 1;
+	}
+	int arg = host ? 3 : 4;
+	int tickCount = argc > arg ? std::atoi(args[arg]) : 2400;
+	float loss = argc > arg + 1 ? std::atof(args[arg + 1]) : 0;
+	int latency = argc > arg + 2 ? std::atoi(args[arg + 2]) : 0;
+	bool desync = join && argc > arg + 3 && strcmp(args[arg + 3], "desync") == 0;
+	//the first confirmed tick the ball is nudged after
+	int nudgeTick = tickCount/2;
+
+	LevelPack pack;
+	if (!pack.open("res/levels/course.pack"))
+	{
+		return 1;
+	}
+	UdpSocket socket;
+	if (host ? !socket.open(std::atoi(args[2])) : !socket.open(0) || !socket.setPeer(args[2], std::atoi(args[3])))
+	{
+		return 1;
+	}
+	socket.simulate(loss, latency);
+
+	int player = host ? 0 : 1;
+	Session session(&pack);
+	session.setCourseCount(VERSUS_PLAYERS, Ball(0, 0, 0, 0, 0, 0, 0));
+	session.loadLevel(0);
+	Lockstep lockstep(session, player, 8);
+
+	uint32_t seed = 0x2545f491 + player*7919;
+	int nextShotTick = 60;
+	uint8_t packet[MAX_PACKET_SIZE];
+	int shots = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point done;
+	bool finished = false;
+	double lastSend = -SEND_INTERVAL_SECONDS;
+	while (true)
+	{
+		int size;
+		while ((size = socket.receive(packet, sizeof(packet))) > 0)
+		{
+			lockstep.readPacket(packet, size);
+		}
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		int dueTick = elapsed*SIM_TICK_RATE;
+		//whoever runs ahead lets the other catch up
+		if (lockstep.shouldWait())
+		{
+			start += std::chrono::microseconds((int)(1000*SIM_STEP_MS));
+		}
+		while (lockstep.getTick() < dueTick && lockstep.getTick() < tickCount && lockstep.canAdvance())
+		{
+			const BallState& ball = session.balls[player].getState();
+			if (lockstep.getTick() >= nextShotTick && ball.canMove && !ball.win && !session.finished)
+			{
+				Vector2f drag((int)(nextRandom(seed) % 301) - 150, (int)(nextRandom(seed) % 301) - 150);
+				if (lockstep.shoot(drag))
+				{
+					shots++;
+				}
+				nextShotTick = lockstep.getTick() + 30 + nextRandom(seed) % 200;
+			}
+			//a late shot rolling back past the nudge undoes it, so it is repeated
+			//if two hash intervals later nothing has been caught
+			if (desync && lockstep.getConfirmedTick() >= nudgeTick && lockstep.getResyncCount() == 0 && !lockstep.isDesynced())
+			{
+				session.balls[player].getState().pos.x += 1;
+				nudgeTick = lockstep.getTick() + 2*HASH_INTERVAL;
+			}
+			lockstep.advance();
+			session.events.clear();
+		}
+		if (elapsed - lastSend >= SEND_INTERVAL_SECONDS)
+		{
+			size = lockstep.writePacket(packet, sizeof(packet));
+			socket.send(packet, size);
+			lastSend = elapsed;
+		}
+
+		if (!finished && lockstep.getConfirmedTick() == tickCount && !lockstep.isDesynced())
+		{
+			finished = true;
+			done = std::chrono::steady_clock::now();
+			std::cout << (host ? "host" : "join") << " tick " << tickCount << " hash " << std::hex << session.hash() << std::dec
+				<< " level " << session.level << " shots " << shots << " rollbacks " << lockstep.getRollbackCount()
+				<< " resyncs " << lockstep.getResyncCount() << std::endl;
+		}
+		if (finished && std::chrono::duration<double>(std::chrono::steady_clock::now() - done).count() > LINGER_SECONDS)
+		{
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	if (desync && lockstep.getResyncCount() == 0)
+	{
+		std::cout << "desync was never caught" << std::endl;
+		return 1;
+	}
+	return 0;
+}